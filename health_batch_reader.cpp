@@ -0,0 +1,377 @@
+#include "config.h"
+
+#include "health_batch_reader.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+#include <sdbusplus/async/fdio.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#if HAVE_IO_URING
+#include <liburing.h>
+
+extern "C"
+{
+#include <sys/eventfd.h>
+}
+#endif
+
+PHOSPHOR_LOG2_USING;
+
+namespace phosphor::health::reader
+{
+
+using phosphor::health::utils::openFile;
+using phosphor::health::utils::readFile;
+
+#if HAVE_IO_URING
+static constexpr auto ringEntries = 64;
+
+struct BatchReader::Ring
+{
+    Ring()
+    {
+        auto rc = io_uring_queue_init(ringEntries, &uring, 0);
+        if (rc < 0)
+        {
+            info("io_uring is not available, using pread: {ERROR}", "ERROR",
+                 strerror(-rc));
+            return;
+        }
+        initialized = true;
+
+        event = FileDescriptor(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC));
+        if (!event || io_uring_register_eventfd(&uring, event.get()) < 0)
+        {
+            info("Unable to await io_uring completions, waiting for them");
+            event = FileDescriptor();
+        }
+    }
+
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    ~Ring()
+    {
+        if (initialized)
+        {
+            io_uring_queue_exit(&uring);
+        }
+    }
+
+    /** @brief Unregister the files and buffers of the batch */
+    void unregister()
+    {
+        if (registered > 0)
+        {
+            io_uring_unregister_buffers(&uring);
+            io_uring_unregister_files(&uring);
+            registered = 0;
+        }
+    }
+
+    /** @brief Register the files and buffers of the batch, if they changed */
+    auto registerFiles(std::vector<File>& files) -> bool
+    {
+        if (registered == files.size())
+        {
+            return true;
+        }
+        unregister();
+
+        std::vector<int> fds;
+        std::vector<iovec> iovecs;
+        for (auto& file : files)
+        {
+            fds.push_back(file.fd.get());
+            iovecs.push_back({file.buffer.get(), file.size});
+        }
+        auto rc = io_uring_register_files(&uring, fds.data(), fds.size());
+        if (rc == 0)
+        {
+            rc = io_uring_register_buffers(&uring, iovecs.data(),
+                                           iovecs.size());
+            if (rc < 0)
+            {
+                io_uring_unregister_files(&uring);
+            }
+        }
+        if (rc < 0)
+        {
+            error("Failed to register files with io_uring: {ERROR}", "ERROR",
+                  strerror(-rc));
+            return false;
+        }
+        registered = files.size();
+        return true;
+    }
+
+    /** @brief Queue the reads of the files from the slot on, until the
+     *         submission queue is full, and get the number queued */
+    auto queue(std::vector<File>& files, slot_t& slot) -> unsigned
+    {
+        unsigned queued = 0;
+        for (; slot < files.size(); slot++)
+        {
+            auto& file = files[slot];
+            file.length = -1;
+            if (!file.fd)
+            {
+                continue;
+            }
+
+            auto* sqe = io_uring_get_sqe(&uring);
+            if (sqe == nullptr)
+            {
+                // More files than ring entries, the rest are queued next
+                break;
+            }
+            io_uring_prep_read_fixed(sqe, slot, file.buffer.get(), file.size,
+                                     0, slot);
+            sqe->flags |= IOSQE_FIXED_FILE;
+            io_uring_sqe_set_data64(sqe, slot);
+            queued++;
+        }
+        return queued;
+    }
+
+    /** @brief Get the length of the reads which completed, and the number of
+     *         them */
+    auto reap(std::vector<File>& files) -> unsigned
+    {
+        unsigned completed = 0;
+        io_uring_cqe* cqe = nullptr;
+        while (io_uring_peek_cqe(&uring, &cqe) == 0)
+        {
+            files[io_uring_cqe_get_data64(cqe)].length = cqe->res;
+            io_uring_cqe_seen(&uring, cqe);
+            completed++;
+        }
+        return completed;
+    }
+
+    /** @brief Clear the completion count of the eventfd */
+    void drain()
+    {
+        eventfd_t count = 0;
+        eventfd_read(event.get(), &count);
+    }
+
+    /** @brief The ring */
+    io_uring uring{};
+    /** @brief The ring was set up */
+    bool initialized = false;
+    /** @brief Number of files and buffers registered with the ring */
+    size_t registered = 0;
+    /** @brief Eventfd signalled by the ring on completions, if registered */
+    FileDescriptor event;
+};
+#else
+struct BatchReader::Ring
+{};
+#endif
+
+BatchReader::BatchReader()
+{
+#if HAVE_IO_URING
+    ring = std::make_unique<Ring>();
+    if (!ring->initialized)
+    {
+        ring.reset();
+    }
+#endif
+}
+
+BatchReader::~BatchReader() = default;
+
+auto BatchReader::add(const std::string& path, size_t size) -> slot_t
+{
+    if (auto match = std::ranges::find(files, path, &File::path);
+        match != files.end())
+    {
+        return match - files.begin();
+    }
+
+    auto& file = files.emplace_back(
+        File{.path = path,
+             .fd = openFile(path),
+             .buffer = std::make_unique<char[]>(size),
+             .size = size});
+    if (!file.fd)
+    {
+        debug("Unable to open {PATH} for reading", "PATH", path);
+    }
+    return files.size() - 1;
+}
+
+auto BatchReader::reopen(slot_t slot) -> bool
+{
+    auto& file = files[slot];
+    file.fd = openFile(file.path);
+    file.length = -1;
+    file.parsed.reset();
+    // Only read a new batch for the file if it could be opened
+    file.pending = static_cast<bool>(file.fd);
+#if HAVE_IO_URING
+    if (ring && slot < ring->registered)
+    {
+        auto fd = file.fd.get();
+        if (io_uring_register_files_update(&ring->uring, slot, &fd, 1) < 0)
+        {
+            // Register everything again with the next batch
+            ring->unregister();
+        }
+    }
+#endif
+    return static_cast<bool>(file.fd);
+}
+
+auto BatchReader::reopen(slot_t slot, const std::string& path) -> bool
+{
+    files[slot].path = path;
+    return reopen(slot);
+}
+
+auto BatchReader::get(slot_t slot) -> std::optional<std::string_view>
+{
+    auto& file = files[slot];
+    if (file.pending)
+    {
+        // Only the new file is read, the others are from the last batch
+        readSlot(file);
+    }
+    if (file.length < 0)
+    {
+        return std::nullopt;
+    }
+    return std::string_view(file.buffer.get(), file.length);
+}
+
+void BatchReader::read()
+{
+    readTime = std::chrono::steady_clock::now();
+    if (!readRing())
+    {
+        // Stay on pread if the ring failed
+        ring.reset();
+        readFiles();
+    }
+    endBatch();
+}
+
+auto BatchReader::read([[maybe_unused]] sdbusplus::async::context& ctx)
+    -> sdbusplus::async::task<>
+{
+#if HAVE_IO_URING
+    if (ring && ring->event && ring->registerFiles(files))
+    {
+        readTime = std::chrono::steady_clock::now();
+        sdbusplus::async::fdio fdio(ctx, ring->event.get());
+        slot_t slot = 0;
+        while (slot < files.size())
+        {
+            auto pending = ring->queue(files, slot);
+            if (pending == 0)
+            {
+                continue;
+            }
+            auto rc = io_uring_submit(&ring->uring);
+            if (rc < 0)
+            {
+                error("Failed to submit reads to io_uring: {ERROR}", "ERROR",
+                      strerror(-rc));
+                ring.reset();
+                break;
+            }
+            while (true)
+            {
+                pending -= ring->reap(files);
+                if (pending == 0)
+                {
+                    break;
+                }
+                co_await fdio.next();
+                ring->drain();
+            }
+        }
+        if (ring)
+        {
+            endBatch();
+            co_return;
+        }
+    }
+#endif
+    read();
+    co_return;
+}
+
+void BatchReader::readSlot(File& file)
+{
+    auto content = readFile(file.fd, {file.buffer.get(), file.size});
+    file.length = content ? static_cast<ssize_t>(content->size()) : -1;
+    file.pending = false;
+    file.parsed.reset();
+}
+
+void BatchReader::readFiles()
+{
+    for (auto& file : files)
+    {
+        readSlot(file);
+    }
+}
+
+void BatchReader::endBatch()
+{
+    for (auto& file : files)
+    {
+        file.pending = false;
+        file.parsed.reset();
+    }
+}
+
+auto BatchReader::readRing() -> bool
+{
+#if HAVE_IO_URING
+    if (!ring || !ring->registerFiles(files))
+    {
+        return false;
+    }
+
+    slot_t slot = 0;
+    while (slot < files.size())
+    {
+        auto pending = ring->queue(files, slot);
+        if (pending == 0)
+        {
+            continue;
+        }
+        // Submit and wait for all the queued reads in one io_uring_enter
+        auto rc = io_uring_submit_and_wait(&ring->uring, pending);
+        if (rc < 0)
+        {
+            error("Failed to submit reads to io_uring: {ERROR}", "ERROR",
+                  strerror(-rc));
+            return false;
+        }
+        pending -= ring->reap(files);
+        for (; pending > 0; pending--)
+        {
+            io_uring_cqe* cqe = nullptr;
+            if (io_uring_wait_cqe(&ring->uring, &cqe) < 0)
+            {
+                return false;
+            }
+            files[io_uring_cqe_get_data64(cqe)].length = cqe->res;
+            io_uring_cqe_seen(&ring->uring, cqe);
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace phosphor::health::reader
@@ -0,0 +1,139 @@
+#pragma once
+
+#include "health_utils.hpp"
+
+#include <sdbusplus/async.hpp>
+
+#include <any>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+extern "C"
+{
+#include <sys/types.h>
+}
+
+namespace phosphor::health::reader
+{
+
+using phosphor::health::utils::FileDescriptor;
+
+/** @brief Reader for the procfs, sysfs and cgroupfs files of all the
+ *         collections, which are kept open and read in one batch per cycle.
+ *
+ *  With io_uring, the reads of the whole batch are submitted with a single
+ *  io_uring_enter, using registered files and buffers, and on the event loop
+ *  their completions are awaited through an eventfd registered with the
+ *  ring. Without it, or if the ring can't be set up, each file is read with
+ *  pread.
+ *
+ *  The batch is read once per cycle with read(). The content of a file is
+ *  from the last batch, unless the file was added or reopened since, in
+ *  which case getting it reads only that file. A file added by several
+ *  collections is only read once per batch, and can be parsed once per batch
+ *  for all of them with parse().
+ */
+class BatchReader
+{
+  public:
+    using slot_t = size_t;
+
+    /** @brief Default buffer size for a file */
+    static constexpr size_t defaultSize = 8192;
+
+    BatchReader();
+    BatchReader(const BatchReader&) = delete;
+    BatchReader& operator=(const BatchReader&) = delete;
+    ~BatchReader();
+
+    /** @brief Add a file to the batch, reading at most size bytes of it, or
+     *         get the slot of the file if it is already in the batch */
+    auto add(const std::string& path, size_t size = defaultSize) -> slot_t;
+    /** @brief Reopen the file of the slot, e.g. when it was recreated */
+    auto reopen(slot_t slot) -> bool;
+    /** @brief Reopen the slot on another file, e.g. of a new process */
+    auto reopen(slot_t slot, const std::string& path) -> bool;
+    /** @brief Check if the file of the slot is open */
+    auto isOpen(slot_t slot) const -> bool
+    {
+        return static_cast<bool>(files[slot].fd);
+    }
+    /** @brief Get the content of the file from the last batch */
+    auto get(slot_t slot) -> std::optional<std::string_view>;
+    /** @brief Get the content of the file from the last batch parsed by the
+     *         parser, which is kept until the next batch, so a file shared
+     *         by several collections is parsed once per batch */
+    template <typename Parser>
+    auto parse(slot_t slot, Parser&& parser)
+        -> const std::invoke_result_t<Parser, std::string_view>*
+    {
+        using parsed_t = std::invoke_result_t<Parser, std::string_view>;
+        auto content = get(slot);
+        if (!content)
+        {
+            return nullptr;
+        }
+        auto& parsed = files[slot].parsed;
+        if (auto* cached = std::any_cast<parsed_t>(&parsed))
+        {
+            return cached;
+        }
+        return &parsed.emplace<parsed_t>(
+            std::forward<Parser>(parser)(*content));
+    }
+    /** @brief Read all the files of the batch, waiting for the reads */
+    void read();
+    /** @brief Read all the files of the batch, awaiting the completion of
+     *         the reads on the event loop */
+    auto read(sdbusplus::async::context& ctx) -> sdbusplus::async::task<>;
+    /** @brief Get the monotonic time at which the batch was read */
+    auto timestamp() const -> std::chrono::steady_clock::time_point
+    {
+        return readTime;
+    }
+
+  private:
+    struct File
+    {
+        /** @brief Path of the file */
+        std::string path;
+        /** @brief Open file */
+        FileDescriptor fd;
+        /** @brief Buffer for the content */
+        std::unique_ptr<char[]> buffer;
+        /** @brief Size of the buffer */
+        size_t size = 0;
+        /** @brief Length read in the last batch, negative on error */
+        ssize_t length = -1;
+        /** @brief Added or reopened since the last batch */
+        bool pending = true;
+        /** @brief Content of the last batch parsed, if it was */
+        std::any parsed;
+    };
+
+    /** @brief Read a file on its own with pread */
+    void readSlot(File& file);
+    /** @brief Read the batch with pread */
+    void readFiles();
+    /** @brief Mark the files as read with the batch */
+    void endBatch();
+    /** @brief Read the batch with io_uring, false if it isn't usable */
+    auto readRing() -> bool;
+
+    /** @brief Files of the batch, by slot */
+    std::vector<File> files;
+    /** @brief Time at which the batch was read */
+    std::chrono::steady_clock::time_point readTime;
+
+    struct Ring;
+    /** @brief io_uring backend, if available */
+    std::unique_ptr<Ring> ring;
+};
+
+} // namespace phosphor::health::reader
@@ -0,0 +1,240 @@
+#include "health_exporter.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+#include <sdbusplus/async/fdio.hpp>
+
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <iterator>
+#include <utility>
+
+extern "C"
+{
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+}
+
+PHOSPHOR_LOG2_USING;
+
+namespace phosphor::health::exporter
+{
+
+namespace
+{
+
+struct FamilyInfo
+{
+    std::string_view name;
+    std::string_view help;
+};
+
+// Indexed by Family
+constexpr std::array<FamilyInfo, 6> familyInfo{{
+    {"bmc_health_metric", "Current value of the health metric"},
+    {"bmc_health_window",
+     "Statistic of the metric window compared against the thresholds"},
+    {"bmc_health_window_samples", "Number of samples in the metric window"},
+    {"bmc_health_threshold", "Threshold value of the health metric"},
+    {"bmc_health_threshold_asserted",
+     "Threshold of the health metric is asserted"},
+    {"bmc_health_log_suppressed",
+     "Number of repeated log messages suppressed by the health monitor"},
+}};
+
+constexpr auto backlog = 8;
+/** @brief Time for a client to read the whole exposition */
+constexpr auto sendTimeout = std::chrono::seconds(1);
+/** @brief Time between the sends to a client which didn't read yet */
+constexpr auto sendRetryInterval = std::chrono::milliseconds(10);
+
+} // namespace
+
+void Series::publish()
+{
+    if (scratch != text)
+    {
+        text.swap(scratch);
+        exposition.dirty = true;
+    }
+}
+
+auto Exposition::add(Family family) -> Series&
+{
+    dirty = true;
+    return series[std::to_underlying(family)].emplace_back(*this);
+}
+
+auto Exposition::content() -> std::string_view
+{
+    if (!dirty)
+    {
+        return output;
+    }
+
+    output.clear();
+    for (size_t family = 0; family < families; family++)
+    {
+        auto& entry = familyInfo[family];
+        std::format_to(std::back_inserter(output),
+                       "# TYPE {0} gauge\n# HELP {0} {1}\n", entry.name,
+                       entry.help);
+        for (const auto& s : series[family])
+        {
+            output += s.text;
+        }
+    }
+    output += "# EOF\n";
+    dirty = false;
+    return output;
+}
+
+auto escapeLabel(std::string_view value) -> std::string
+{
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (auto c : value)
+    {
+        switch (c)
+        {
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '"':
+                escaped += "\\\"";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            default:
+                escaped += c;
+                break;
+        }
+    }
+    return escaped;
+}
+
+void appendSample(std::string& buffer, Family family, std::string_view labels,
+                  double value)
+{
+    auto out = std::back_inserter(buffer);
+    auto& entry = familyInfo[std::to_underlying(family)];
+    if (labels.empty())
+    {
+        std::format_to(out, "{} ", entry.name);
+    }
+    else
+    {
+        std::format_to(out, "{}{{{}}} ", entry.name, labels);
+    }
+    if (std::isnan(value))
+    {
+        buffer += "NaN";
+    }
+    else if (std::isinf(value))
+    {
+        buffer += value > 0 ? "+Inf" : "-Inf";
+    }
+    else
+    {
+        std::format_to(out, "{}", value);
+    }
+    buffer += '\n';
+}
+
+Exporter::Exporter(sdbusplus::async::context& ctx, const std::string& path) :
+    ctx(ctx)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        error("OpenMetrics socket path {PATH} is too long", "PATH", path);
+        return;
+    }
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    std::error_code ec;
+    std::filesystem::create_directories(
+        std::filesystem::path(path).parent_path(), ec);
+    unlink(path.c_str());
+
+    FileDescriptor fd(
+        socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0));
+    if (!fd ||
+        bind(fd.get(), reinterpret_cast<sockaddr*>(&address),
+             sizeof(address)) != 0 ||
+        listen(fd.get(), backlog) != 0)
+    {
+        error("Failed to listen on OpenMetrics socket {PATH}: {ERROR}", "PATH",
+              path, "ERROR", strerror(errno));
+        return;
+    }
+    listener = std::move(fd);
+
+    info("Serving OpenMetrics on {PATH}", "PATH", path);
+    ctx.spawn(serve());
+}
+
+auto Exporter::serve() -> sdbusplus::async::task<>
+{
+    sdbusplus::async::fdio fdio(ctx, listener.get());
+    while (!ctx.stop_requested())
+    {
+        co_await fdio.next();
+        while (true)
+        {
+            FileDescriptor client(accept4(listener.get(), nullptr, nullptr,
+                                          SOCK_NONBLOCK | SOCK_CLOEXEC));
+            if (!client)
+            {
+                break;
+            }
+            // The exposition may change before a slow client read all of it
+            ctx.spawn(
+                sendTo(std::move(client), std::string(metrics.content())));
+        }
+    }
+}
+
+auto Exporter::sendTo(FileDescriptor client, std::string content)
+    -> sdbusplus::async::task<>
+{
+    auto deadline = std::chrono::steady_clock::now() + sendTimeout;
+    std::string_view remaining(content);
+    while (!remaining.empty())
+    {
+        auto sent = send(client.get(), remaining.data(), remaining.size(),
+                         MSG_NOSIGNAL);
+        if (sent >= 0)
+        {
+            remaining.remove_prefix(sent);
+            continue;
+        }
+        auto err = errno;
+        if (err == EINTR)
+        {
+            continue;
+        }
+        if ((err == EAGAIN || err == EWOULDBLOCK) &&
+            std::chrono::steady_clock::now() < deadline &&
+            !ctx.stop_requested())
+        {
+            // The socket buffer is full until the client reads it, the
+            // event loop runs meanwhile
+            co_await sdbusplus::async::sleep_for(ctx, sendRetryInterval);
+            continue;
+        }
+        warning("Dropped the OpenMetrics client after {SENT} of {SIZE} "
+                "bytes: {ERROR}",
+                "SENT", content.size() - remaining.size(), "SIZE",
+                content.size(), "ERROR", strerror(err));
+        co_return;
+    }
+}
+
+} // namespace phosphor::health::exporter
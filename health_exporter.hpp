@@ -0,0 +1,133 @@
+#pragma once
+
+#include "health_utils.hpp"
+
+#include <sdbusplus/async.hpp>
+
+#include <array>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace phosphor::health::exporter
+{
+
+using phosphor::health::utils::FileDescriptor;
+
+/** @brief Metric families of the exposition */
+enum class Family
+{
+    value,
+    window,
+    samples,
+    threshold,
+    asserted,
+    suppressed
+};
+
+class Exposition;
+
+/** @brief Preformatted sample lines of one metric in a family */
+class Series
+{
+  public:
+    explicit Series(Exposition& exposition) : exposition(exposition) {}
+    Series(const Series&) = delete;
+    Series& operator=(const Series&) = delete;
+
+    /** @brief Get an empty buffer for the new lines of the series */
+    auto buffer() -> std::string&
+    {
+        scratch.clear();
+        return scratch;
+    }
+
+    /** @brief Publish the new lines, if they changed */
+    void publish();
+
+  private:
+    friend class Exposition;
+
+    /** @brief Exposition of the series */
+    Exposition& exposition;
+    /** @brief Published lines */
+    std::string text;
+    /** @brief Lines being formatted */
+    std::string scratch;
+};
+
+/** @brief OpenMetrics text exposition of the health metrics.
+ *
+ *  Each metric formats its own series when it is updated, and a series is
+ *  only replaced when its lines changed. The exposition is concatenated from
+ *  the series on demand when any of them changed, into a buffer which keeps
+ *  its capacity, so serving it doesn't allocate.
+ */
+class Exposition
+{
+  public:
+    /** @brief Add a series to the family */
+    auto add(Family family) -> Series&;
+    /** @brief Get the exposition text */
+    auto content() -> std::string_view;
+
+  private:
+    friend class Series;
+
+    static constexpr size_t families = 6;
+
+    /** @brief Series by family, with stable addresses */
+    std::array<std::deque<Series>, families> series;
+    /** @brief Concatenated exposition */
+    std::string output;
+    /** @brief A series changed since the output was concatenated */
+    bool dirty = true;
+};
+
+/** @brief Escape a label value, i.e. backslashes, double quotes and line
+ *         feeds, as required by OpenMetrics */
+auto escapeLabel(std::string_view value) -> std::string;
+
+/** @brief Append a sample line to the series buffer, without labels if they
+ *         are empty */
+void appendSample(std::string& buffer, Family family, std::string_view labels,
+                  double value);
+
+/** @brief Server for the exposition on a Unix domain socket.
+ *
+ *  The exposition is written to each client as soon as it connects, and the
+ *  connection is closed, so a scrape is a single read until end of file. An
+ *  exposition larger than the socket buffer is written by a coroutine of the
+ *  client as the client reads it, so a slow client doesn't hold up the event
+ *  loop, and a client which didn't read all of it within a second is
+ *  dropped.
+ */
+class Exporter
+{
+  public:
+    Exporter(sdbusplus::async::context& ctx, const std::string& path);
+
+    /** @brief Get the exposition of the metrics */
+    auto exposition() -> Exposition&
+    {
+        return metrics;
+    }
+
+  private:
+    /** @brief Accept the clients and serve them the exposition */
+    auto serve() -> sdbusplus::async::task<>;
+    /** @brief Send the content to the non-blocking client, until it is
+     *         sent or the send timeout elapsed */
+    auto sendTo(FileDescriptor client, std::string content)
+        -> sdbusplus::async::task<>;
+
+    /** @brief D-Bus context */
+    sdbusplus::async::context& ctx;
+    /** @brief Listening socket */
+    FileDescriptor listener;
+    /** @brief Exposition of the metrics */
+    Exposition metrics;
+};
+
+} // namespace phosphor::health::exporter
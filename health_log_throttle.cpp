@@ -0,0 +1,74 @@
+#include "health_log_throttle.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+PHOSPHOR_LOG2_USING;
+
+namespace phosphor::health::throttle
+{
+
+auto LogThrottle::admit(std::string_view key, clock::time_point now) -> bool
+{
+    auto entry = entries.find(key);
+    if (entry == entries.end())
+    {
+        entries.emplace(key, Entry{.logged = now});
+        return true;
+    }
+
+    if (now - entry->second.logged >= interval)
+    {
+        summarize(key, entry->second);
+        entry->second = Entry{.logged = now};
+        return true;
+    }
+
+    entry->second.suppressed++;
+    total++;
+    exportValue();
+    return false;
+}
+
+void LogThrottle::clear(std::string_view key)
+{
+    auto entry = entries.find(key);
+    if (entry == entries.end())
+    {
+        return;
+    }
+    summarize(key, entry->second);
+    entries.erase(entry);
+}
+
+void LogThrottle::summarize(std::string_view key, const Entry& entry)
+{
+    if (entry.suppressed > 0)
+    {
+        info("Suppressed {COUNT} repeated messages for {KEY}", "COUNT",
+             entry.suppressed, "KEY", key);
+    }
+}
+
+void LogThrottle::exportTo(exporter::Exposition& exposition)
+{
+    series = &exposition.add(exporter::Family::suppressed);
+    exportValue();
+}
+
+void LogThrottle::exportValue()
+{
+    if (series == nullptr)
+    {
+        return;
+    }
+    appendSample(series->buffer(), exporter::Family::suppressed, "", total);
+    series->publish();
+}
+
+auto logThrottle() -> LogThrottle&
+{
+    static LogThrottle throttle;
+    return throttle;
+}
+
+} // namespace phosphor::health::throttle
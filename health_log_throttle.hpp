@@ -0,0 +1,85 @@
+#pragma once
+
+#include "health_exporter.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace phosphor::health::throttle
+{
+
+/** @brief Throttle for the log messages of the error paths which repeat on
+ *         every collection, like a storage path which disappeared.
+ *
+ *  The first message for a key is logged, and its repeats are suppressed
+ *  until the interval elapsed, when a summary with the number of suppressed
+ *  repeats is logged along with the next one. A key is cleared once its
+ *  error went away, so it is logged again as soon as it comes back.
+ */
+class LogThrottle
+{
+  public:
+    using clock = std::chrono::steady_clock;
+
+    /** @brief Default interval between the messages for a key */
+    static constexpr auto defaultInterval = std::chrono::minutes(10);
+
+    explicit LogThrottle(clock::duration interval = defaultInterval) :
+        interval(interval)
+    {}
+
+    /** @brief Whether the message for the key should be logged now */
+    auto admit(std::string_view key, clock::time_point now = clock::now())
+        -> bool;
+
+    /** @brief Clear the key after its error went away */
+    void clear(std::string_view key);
+
+    /** @brief Get the number of messages suppressed in total */
+    auto suppressed() const -> uint64_t
+    {
+        return total;
+    }
+
+    /** @brief Add the suppression counter to the OpenMetrics exposition */
+    void exportTo(exporter::Exposition& exposition);
+
+  private:
+    struct Entry
+    {
+        /** @brief Time the last message for the key was logged */
+        clock::time_point logged;
+        /** @brief Repeats suppressed since the last message */
+        uint64_t suppressed = 0;
+    };
+
+    /** @brief Hash of the keys, which can be looked up by string_view */
+    struct Hash : std::hash<std::string_view>
+    {
+        using is_transparent = void;
+    };
+
+    /** @brief Log the number of suppressed repeats of the key, if any */
+    static void summarize(std::string_view key, const Entry& entry);
+    /** @brief Update the suppression counter in the exposition */
+    void exportValue();
+
+    /** @brief Minimum time between the messages for a key */
+    clock::duration interval;
+    /** @brief Throttled keys */
+    std::unordered_map<std::string, Entry, Hash, std::equal_to<>> entries;
+    /** @brief Messages suppressed in total */
+    uint64_t total = 0;
+    /** @brief Series of the counter in the OpenMetrics exposition, if
+     *         exported */
+    exporter::Series* series = nullptr;
+};
+
+/** @brief Get the log throttle of the health monitor */
+auto logThrottle() -> LogThrottle&;
+
+} // namespace phosphor::health::throttle
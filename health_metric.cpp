@@ -1,9 +1,12 @@
 #include "health_metric.hpp"
 
+#include "health_trace.hpp"
+
 #include <phosphor-logging/lg2.hpp>
 
 #include <cmath>
-#include <numeric>
+#include <filesystem>
+#include <format>
 #include <unordered_map>
 
 PHOSPHOR_LOG2_USING;
@@ -13,11 +16,10 @@ namespace phosphor::health::metric
 
 using association_t = std::tuple<std::string, std::string, std::string>;
 
-auto HealthMetric::getPath(MType type, std::string name, SubType subType)
+auto HealthMetric::getPath(MType type, const config::HealthMetric& config)
     -> std::string
 {
-    std::string path;
-    switch (subType)
+    switch (config.subType)
     {
         case SubType::cpuTotal:
         {
@@ -52,11 +54,83 @@ auto HealthMetric::getPath(MType type, std::string name, SubType subType)
         {
             return std::string(BmcPath) + "/" + PathIntf::total_memory;
         }
+        case SubType::memorySwapFree:
+        case SubType::memorySwapTotal:
+        {
+            auto path = sdbusplus::message::object_path(BmcPath) / "memory" /
+                        (config.subType == SubType::memorySwapFree
+                             ? "swap_free"
+                             : "swap_total");
+            return path.str;
+        }
+        case SubType::cgroupCPU:
+        case SubType::cgroupMemory:
+        {
+            // Cgroup metric path is the cgroup directory of the service
+            auto service = std::filesystem::path(config.path).filename();
+            auto path = sdbusplus::message::object_path(BmcPath) / "service" /
+                        service.string() /
+                        (config.subType == SubType::cgroupCPU ? "cpu"
+                                                              : "memory");
+            return path.str;
+        }
+        case SubType::processRSS:
+        case SubType::processPSS:
+        {
+            // Process metric path is the systemd service of the process
+            auto path = sdbusplus::message::object_path(BmcPath) / "service" /
+                        config.path /
+                        (config.subType == SubType::processRSS ? "rss"
+                                                               : "pss");
+            return path.str;
+        }
+        case SubType::storageMounts:
+        {
+            // Discovered storage metric path is the escaped mount point
+            auto path = sdbusplus::message::object_path(BmcPath) /
+                        PathIntf::storage / "mounts" / config.path;
+            return path.str;
+        }
+        case SubType::kernelFileHandles:
+        case SubType::kernelProcesses:
+        case SubType::kernelLoad1:
+        case SubType::kernelLoad5:
+        case SubType::kernelLoad15:
+        case SubType::kernelContextSwitches:
+        case SubType::kernelForks:
+        {
+            static const std::unordered_map<SubType, std::string> names = {
+                {SubType::kernelFileHandles, "file_handles"},
+                {SubType::kernelProcesses, "processes"},
+                {SubType::kernelLoad1, "load_1"},
+                {SubType::kernelLoad5, "load_5"},
+                {SubType::kernelLoad15, "load_15"},
+                {SubType::kernelContextSwitches, "context_switches"},
+                {SubType::kernelForks, "forks"}};
+            auto path = sdbusplus::message::object_path(BmcPath) / "kernel" /
+                        names.at(config.subType);
+            return path.str;
+        }
+        case SubType::vmstatMajorFaults:
+        case SubType::vmstatSwapIn:
+        case SubType::vmstatSwapOut:
+        case SubType::vmstatOomKills:
+        {
+            static const std::unordered_map<SubType, std::string> names = {
+                {SubType::vmstatMajorFaults, "major_faults"},
+                {SubType::vmstatSwapIn, "swap_in"},
+                {SubType::vmstatSwapOut, "swap_out"},
+                {SubType::vmstatOomKills, "oom_kills"}};
+            auto path = sdbusplus::message::object_path(BmcPath) / "vmstat" /
+                        names.at(config.subType);
+            return path.str;
+        }
         case SubType::NA:
         {
             if (type == MType::storage)
             {
                 static constexpr auto nameDelimiter = "_";
+                auto& name = config.name;
                 auto storageType = name.substr(
                     name.find_last_of(nameDelimiter) + 1, name.length());
                 std::ranges::for_each(storageType, [](auto& c) {
@@ -68,13 +142,13 @@ auto HealthMetric::getPath(MType type, std::string name, SubType subType)
             else
             {
                 error("Invalid metric {SUBTYPE} for metric {TYPE}", "SUBTYPE",
-                      subType, "TYPE", type);
+                      config.subType, "TYPE", type);
                 return "";
             }
         }
         default:
         {
-            error("Invalid metric {SUBTYPE}", "SUBTYPE", subType);
+            error("Invalid metric {SUBTYPE}", "SUBTYPE", config.subType);
             return "";
         }
     }
@@ -93,11 +167,42 @@ void HealthMetric::initProperties()
         }
         case MType::memory:
         case MType::storage:
+        {
+            // Time to exhaustion is in seconds, Metric.Value has no such unit
+            if (config.subType != SubType::timeToExhaustion)
+            {
+                ValueIntf::unit(ValueIntf::Unit::Bytes, true);
+            }
+            ValueIntf::minValue(0.0, true);
+            break;
+        }
+        case MType::cgroup:
+        {
+            if (config.subType == SubType::cgroupCPU)
+            {
+                ValueIntf::unit(ValueIntf::Unit::Percent, true);
+                ValueIntf::maxValue(100.0, true);
+            }
+            else
+            {
+                ValueIntf::unit(ValueIntf::Unit::Bytes, true);
+            }
+            ValueIntf::minValue(0.0, true);
+            break;
+        }
+        case MType::process:
         {
             ValueIntf::unit(ValueIntf::Unit::Bytes, true);
             ValueIntf::minValue(0.0, true);
             break;
         }
+        case MType::kernel:
+        case MType::vmstat:
+        {
+            // Counts, load averages and rates have no Metric.Value unit
+            ValueIntf::minValue(0.0, true);
+            break;
+        }
         case MType::inode:
         case MType::unknown:
         default:
@@ -149,14 +254,45 @@ bool didThresholdViolate(ThresholdIntf::Bound bound, double thresholdValue,
     }
 }
 
-void HealthMetric::checkThreshold(Type type, Bound bound, MValue value)
+void HealthMetric::updateSubWindows()
+{
+    for (auto& [threshold, window] : subWindows)
+    {
+        window.sum += history.back().value;
+        if (window.count < window.size)
+        {
+            window.count++;
+            continue;
+        }
+        // The sub-window is shorter than the window, so the history still has
+        // the sample leaving it
+        window.sum -= history[history.size() - 1 - window.size].value;
+    }
+}
+
+void HealthMetric::checkThreshold(Type type, Bound bound, MValue value,
+                                  std::optional<double> statistic)
 {
     auto threshold = std::make_tuple(type, bound);
+    if (auto window = subWindows.find(threshold); window != subWindows.end())
+    {
+        statistic = std::nullopt;
+        if (window->second.count == window->second.size)
+        {
+            statistic = window->second.sum / window->second.size;
+        }
+    }
+    if (!statistic)
+    {
+        // Wait for enough samples to evaluate the threshold on
+        return;
+    }
+    value.current = *statistic;
     auto thresholds = ThresholdIntf::value();
 
     if (thresholds.contains(type) && thresholds[type].contains(bound))
     {
-        auto tConfig = config.thresholds.at(threshold);
+        const auto& tConfig = config.thresholds.at(threshold);
         auto thresholdValue = tConfig.value / 100 * value.total;
         thresholds[type][bound] = thresholdValue;
         ThresholdIntf::value(thresholds);
@@ -169,6 +305,18 @@ void HealthMetric::checkThreshold(Type type, Bound bound, MValue value)
                 ThresholdIntf::asserted(assertions);
                 ThresholdIntf::assertionChanged(type, bound, true,
                                                 value.current);
+                HEALTH_TRACE(threshold_assert, config.name.c_str(),
+                             static_cast<int>(type), static_cast<int>(bound),
+                             trace::milli(value.current));
+                if (snapshotter != nullptr && type != Type::Warning &&
+                    type != Type::PerformanceLoss)
+                {
+                    snapshotter->capture(
+                        {.metric = config.name,
+                         .threshold = config::thresholdKey(type, bound),
+                         .value = value.current,
+                         .history = history.copy()});
+                }
                 if (tConfig.log)
                 {
                     error(
@@ -184,6 +332,9 @@ void HealthMetric::checkThreshold(Type type, Bound bound, MValue value)
             assertions.erase(threshold);
             ThresholdIntf::asserted(assertions);
             ThresholdIntf::assertionChanged(type, bound, false, value.current);
+            HEALTH_TRACE(threshold_deassert, config.name.c_str(),
+                         static_cast<int>(type), static_cast<int>(bound),
+                         trace::milli(value.current));
             if (config.thresholds.find(threshold)->second.log)
             {
                 info(
@@ -194,15 +345,16 @@ void HealthMetric::checkThreshold(Type type, Bound bound, MValue value)
     }
 }
 
-void HealthMetric::checkThresholds(MValue value)
+void HealthMetric::checkThresholds(MValue value,
+                                   std::optional<double> statistic)
 {
     if (!ThresholdIntf::value().empty())
     {
         for (auto type : {Type::HardShutdown, Type::SoftShutdown,
                           Type::PerformanceLoss, Type::Critical, Type::Warning})
         {
-            checkThreshold(type, Bound::Lower, value);
-            checkThreshold(type, Bound::Upper, value);
+            checkThreshold(type, Bound::Lower, value, statistic);
+            checkThreshold(type, Bound::Upper, value, statistic);
         }
     }
 }
@@ -213,44 +365,234 @@ auto HealthMetric::shouldNotify(MValue value) -> bool
     {
         return true;
     }
-    auto changed = std::abs(
-        (value.current - lastNotifiedValue) / lastNotifiedValue * 100.0);
-    if (changed >= config.hysteresis)
-    {
+    auto notify = [&]() {
         lastNotifiedValue = value.current;
+        lastNotifiedTime = value.timestamp;
         return true;
+    };
+    // The first value replaces the NaN the metric was created or marked
+    // stale with
+    if (!lastNotifiedValue)
+    {
+        return notify();
+    }
+
+    auto last = *lastNotifiedValue;
+    auto elapsed = value.timestamp - lastNotifiedTime;
+    if (value.current == last || elapsed < config.minPublishInterval)
+    {
+        return false;
+    }
+    if (config.maxPublishInterval > std::chrono::seconds::zero() &&
+        elapsed >= config.maxPublishInterval)
+    {
+        return notify();
+    }
+    if (std::isinf(value.current) || std::isinf(last))
+    {
+        // Relative change is not defined for infinite values
+        return notify();
+    }
+
+    auto change = std::abs(value.current - last);
+    // Any change from zero is infinitely large relative to it
+    auto relative = (last == 0) ? std::numeric_limits<double>::infinity()
+                                : change / std::abs(last) * 100.0;
+    if (relative >= config.hysteresis && change >= config.hysteresisAbsolute)
+    {
+        return notify();
     }
     return false;
 }
 
+void HealthMetric::markStale()
+{
+    // The window is kept as is, so thresholds resume with the next value
+    stale = true;
+    lastNotifiedValue.reset();
+    ValueIntf::value(std::numeric_limits<double>::quiet_NaN());
+    publish();
+}
+
 void HealthMetric::update(MValue value)
 {
-    ValueIntf::value(value.current, !shouldNotify(value));
+    HEALTH_TRACE(metric_update, config.name.c_str(),
+                 trace::milli(value.current));
+    stale = false;
+    auto notify = shouldNotify(value);
+    if (notify && ValueIntf::value() == value.current)
+    {
+        // The value was already set without a signal, which is only sent
+        // when the property changes
+        ValueIntf::value(std::numeric_limits<double>::quiet_NaN(), true);
+    }
+    ValueIntf::value(value.current, !notify);
 
-    // Maintain window size for threshold calculation
+    // The window is sized for the config, so it evicts the oldest sample
+    aggregator::Sample sample{.timestamp = value.timestamp,
+                              .value = value.current};
+    auto evicted = history.push(sample);
+    if (histogram)
+    {
+        histogram->record(sample.value);
+    }
+    statistic->add(sample.value, evicted.transform(
+                                     [](auto& s) { return s.value; }));
+    updateSubWindows();
+    if (exhaustion)
+    {
+        trend.add(sample, evicted);
+    }
+
+    /*
+     * The thresholds on the window wait for it to fill, while those with a
+     * sub-window, like the shutdown ones on the latest sample, react as soon
+     * as they have their samples.
+     */
+    std::optional<double> windowValue;
     if (history.size() >= config.windowSize)
     {
-        history.pop_front();
+        if (exhaustion)
+        {
+            // Thresholds for the time to exhaustion are absolute, in seconds
+            exhaustion->update(
+                MValue(trend.secondsToZero(), 100, value.timestamp));
+        }
+        windowValue = statistic->value();
     }
-    history.push_back(value.current);
 
-    if (history.size() < config.windowSize)
+    checkThresholds(value, windowValue);
+    publish();
+}
+
+void HealthMetric::exportTo(exporter::Exposition& exposition)
+{
+    using exporter::Family;
+    // The names of the discovered metrics have paths and service names
+    auto labels = std::format("metric=\"{}\",type=\"{}\"",
+                              exporter::escapeLabel(config.name),
+                              to_string(type));
+    auto windowLabels = std::format("{},aggregation=\"{}\"", labels,
+                                    to_string(config.aggregation));
+    exported = std::make_unique<Exported>(
+        Exported{.value = exposition.add(Family::value),
+                 .window = exposition.add(Family::window),
+                 .samples = exposition.add(Family::samples),
+                 .threshold = exposition.add(Family::threshold),
+                 .asserted = exposition.add(Family::asserted),
+                 .labels = std::move(labels),
+                 .windowLabels = std::move(windowLabels),
+                 .thresholds = {}});
+    for (const auto& [key, threshold] : config.thresholds)
     {
-        // Wait for the metric to have enough samples to calculate average
-        return;
+        exported->thresholds.emplace_back(
+            key, std::format("{},threshold=\"{}\"", exported->labels,
+                             config::thresholdKey(get<Type>(key),
+                                                  get<Bound>(key))));
     }
+    exportValues();
 
-    double average =
-        (std::accumulate(history.begin(), history.end(), 0.0)) / history.size();
-    value.current = average;
-    checkThresholds(value);
+    if (exhaustion)
+    {
+        exhaustion->exportTo(exposition);
+    }
 }
 
-void HealthMetric::create(const paths_t& bmcPaths)
+void HealthMetric::shareTo(shm::Writer& writer)
 {
-    info("Create Health Metric: {METRIC}", "METRIC", config.name);
-    initProperties();
+    if (auto index = writer.add(config.name))
+    {
+        shared = &writer;
+        sharedIndex = *index;
+        shareValues();
+    }
+
+    if (exhaustion)
+    {
+        exhaustion->shareTo(writer);
+    }
+}
+
+void HealthMetric::announce()
+{
+    this->emit_object_added();
+
+    if (exhaustion)
+    {
+        exhaustion->announce();
+    }
+}
+
+void HealthMetric::snapshotTo(snapshot::Snapshotter& snapshotter)
+{
+    this->snapshotter = &snapshotter;
+
+    if (exhaustion)
+    {
+        exhaustion->snapshotTo(snapshotter);
+    }
+}
+
+void HealthMetric::publish()
+{
+    exportValues();
+    shareValues();
+}
+
+void HealthMetric::shareValues()
+{
+    if (shared == nullptr)
+    {
+        return;
+    }
+    uint32_t flags = 0;
+    if (stale)
+    {
+        flags |= shm::Flags::stale;
+    }
+    if (!ThresholdIntf::asserted().empty())
+    {
+        flags |= shm::Flags::asserted;
+    }
+    shared->set(sharedIndex, ValueIntf::value(), statistic->value(), flags);
+}
 
+void HealthMetric::exportValues()
+{
+    using exporter::Family;
+    if (!exported)
+    {
+        return;
+    }
+
+    appendSample(exported->value.buffer(), Family::value, exported->labels,
+                 ValueIntf::value());
+    exported->value.publish();
+    appendSample(exported->window.buffer(), Family::window,
+                 exported->windowLabels, statistic->value());
+    exported->window.publish();
+    appendSample(exported->samples.buffer(), Family::samples,
+                 exported->labels, history.size());
+    exported->samples.publish();
+
+    auto thresholds = ThresholdIntf::value();
+    auto assertions = ThresholdIntf::asserted();
+    auto& thresholdBuffer = exported->threshold.buffer();
+    auto& assertedBuffer = exported->asserted.buffer();
+    for (const auto& [key, labels] : exported->thresholds)
+    {
+        auto [thresholdType, bound] = key;
+        appendSample(thresholdBuffer, Family::threshold, labels,
+                     thresholds[thresholdType][bound]);
+        appendSample(assertedBuffer, Family::asserted, labels,
+                     assertions.contains(key) ? 1 : 0);
+    }
+    exported->threshold.publish();
+    exported->asserted.publish();
+}
+
+void HealthMetric::updateAssociations(const paths_t& bmcPaths)
+{
     std::vector<association_t> associations;
     static constexpr auto forwardAssociation = "measuring";
     static constexpr auto reverseAssociation = "measured_by";
@@ -266,4 +608,58 @@ void HealthMetric::create(const paths_t& bmcPaths)
     AssociationIntf::associations(associations);
 }
 
+void HealthMetric::createExhaustion(const std::string& path,
+                                    const paths_t& bmcPaths,
+                                    std::pmr::memory_resource* memory)
+{
+    if (type != MType::memory && type != MType::storage)
+    {
+        warning("Time to exhaustion not supported for {METRIC}", "METRIC",
+                config.name);
+        return;
+    }
+
+    exhaustionConfig = std::make_unique<config::HealthMetric>();
+    exhaustionConfig->name = config.name + "_TimeToExhaustion";
+    exhaustionConfig->subType = SubType::timeToExhaustion;
+    // The trend is already computed over the window of this metric
+    exhaustionConfig->windowSize = 1;
+    exhaustionConfig->hysteresis = config.hysteresis;
+    exhaustionConfig->thresholds.emplace(
+        std::make_tuple(Type::Critical, Bound::Lower),
+        *config.timeToExhaustion);
+
+    exhaustion = std::unique_ptr<HealthMetric>(
+        new HealthMetric(bus, type, *exhaustionConfig,
+                         path + "/time_to_exhaustion", bmcPaths, memory));
+}
+
+void HealthMetric::create(const std::string& path, const paths_t& bmcPaths,
+                          std::pmr::memory_resource* memory)
+{
+    info("Create Health Metric: {METRIC}", "METRIC", config.name);
+    initProperties();
+    updateAssociations(bmcPaths);
+
+    for (const auto& [threshold, tConfig] : config.thresholds)
+    {
+        if (tConfig.windowSize > 0 && tConfig.windowSize < config.windowSize)
+        {
+            subWindows.emplace(threshold,
+                               SubWindow{.size = tConfig.windowSize});
+        }
+    }
+
+    if (config.histogramPrecision > 0)
+    {
+        histogram = std::make_unique<HistogramIntf>(bus, path,
+                                                    config.histogramPrecision);
+    }
+
+    if (config.timeToExhaustion)
+    {
+        createExhaustion(path, bmcPaths, memory);
+    }
+}
+
 } // namespace phosphor::health::metric
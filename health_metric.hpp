@@ -1,18 +1,27 @@
 #pragma once
 
+#include "health_exporter.hpp"
+#include "health_metric_aggregator.hpp"
 #include "health_metric_config.hpp"
+#include "health_metric_histogram.hpp"
+#include "health_shm_writer.hpp"
+#include "health_snapshot.hpp"
 #include "health_utils.hpp"
 
 #include <xyz/openbmc_project/Association/Definitions/server.hpp>
 #include <xyz/openbmc_project/Inventory/Item/Bmc/server.hpp>
 #include <xyz/openbmc_project/Metric/Value/server.hpp>
 
-#include <deque>
+#include <chrono>
+#include <map>
+#include <memory_resource>
+#include <optional>
 #include <tuple>
 
 namespace phosphor::health::metric
 {
 
+using phosphor::health::utils::FileDescriptor;
 using phosphor::health::utils::paths_t;
 using phosphor::health::utils::startUnit;
 using AssociationIntf =
@@ -32,6 +41,9 @@ struct MValue
     double current;
     /** @brief Total value of metric */
     double total;
+    /** @brief Monotonic time at which the value was read */
+    std::chrono::steady_clock::time_point timestamp =
+        std::chrono::steady_clock::now();
 };
 
 class HealthMetric : public MetricIntf
@@ -44,43 +56,156 @@ class HealthMetric : public MetricIntf
     HealthMetric(HealthMetric&&) = delete;
     virtual ~HealthMetric() = default;
 
+    /** @brief Create a health metric, which refers to the config rather
+     *         than copying it, so the config must outlive the metric. The
+     *         window of the metric is allocated from the memory resource. */
     HealthMetric(sdbusplus::bus_t& bus, MType type,
-                 const config::HealthMetric& config, const paths_t& bmcPaths) :
-        MetricIntf(bus, getPath(type, config.name, config.subType).c_str(),
-                   action::defer_emit),
-        bus(bus), type(type), config(config)
-    {
-        create(bmcPaths);
-        this->emit_object_added();
-    }
+                 const config::HealthMetric& config, const paths_t& bmcPaths,
+                 std::pmr::memory_resource* memory =
+                     std::pmr::get_default_resource()) :
+        HealthMetric(bus, type, config, getPath(type, config), bmcPaths,
+                     memory)
+    {}
+
+    /** @brief Emit the InterfacesAdded signal for the metric objects, which
+     *         are created with their emission deferred */
+    void announce();
 
     /** @brief Update the health metric with the given value */
     void update(MValue value);
 
+    /** @brief Mark the metric value as stale, when it couldn't be read */
+    void markStale();
+
+    /** @brief Check if the metric value is stale */
+    auto isStale() const -> bool
+    {
+        return stale;
+    }
+
+    /** @brief Get the name of the metric */
+    auto name() const -> const std::string&
+    {
+        return config.name;
+    }
+
+    /** @brief Update the BMC inventory paths this metric is measuring */
+    void updateAssociations(const paths_t& bmcPaths);
+
+    /** @brief Add the metric to the OpenMetrics exposition */
+    void exportTo(exporter::Exposition& exposition);
+
+    /** @brief Add the metric to the shared memory segment */
+    void shareTo(shm::Writer& writer);
+
+    /** @brief Capture a snapshot when a severe threshold asserts */
+    void snapshotTo(snapshot::Snapshotter& snapshotter);
+
   private:
+    /** @brief Series of the metric in the OpenMetrics exposition */
+    struct Exported
+    {
+        exporter::Series& value;
+        exporter::Series& window;
+        exporter::Series& samples;
+        exporter::Series& threshold;
+        exporter::Series& asserted;
+        /** @brief Labels of the metric */
+        std::string labels;
+        /** @brief Labels of the metric window */
+        std::string windowLabels;
+        /** @brief Labels of the thresholds of the metric */
+        std::vector<std::pair<std::tuple<Type, Bound>, std::string>>
+            thresholds;
+    };
+
+    /** @brief Running sum of the last samples, for a threshold evaluated on
+     *         fewer samples than the window */
+    struct SubWindow
+    {
+        /** @brief Number of samples the threshold is evaluated on */
+        size_t size;
+        /** @brief Sum of the last samples */
+        double sum = 0;
+        /** @brief Number of samples in the sum, up to the size */
+        size_t count = 0;
+    };
+
+    /** @brief Create a health metric object at the given path */
+    HealthMetric(sdbusplus::bus_t& bus, MType type,
+                 const config::HealthMetric& config, const std::string& path,
+                 const paths_t& bmcPaths, std::pmr::memory_resource* memory) :
+        MetricIntf(bus, path.c_str(), action::defer_emit), bus(bus),
+        type(type), config(config), history(config.windowSize, memory),
+        statistic(aggregator::create(config)), subWindows(memory)
+    {
+        create(path, bmcPaths, memory);
+    }
+
     /** @brief Create a new health metric object */
-    void create(const paths_t& bmcPaths);
+    void create(const std::string& path, const paths_t& bmcPaths,
+                std::pmr::memory_resource* memory);
+    /** @brief Create the time to exhaustion metric for this metric */
+    void createExhaustion(const std::string& path, const paths_t& bmcPaths,
+                          std::pmr::memory_resource* memory);
     /** @brief Init properties for the health metric object */
     void initProperties();
     /** @brief Check if specified value should be notified based on hysteresis
      */
     auto shouldNotify(MValue value) -> bool;
-    /** @brief Check specified threshold for the given value */
-    void checkThreshold(Type type, Bound bound, MValue value);
-    /** @brief Check all thresholds for the given value */
-    void checkThresholds(MValue value);
-    /** @brief Get the object path for the given type, name and subtype */
-    auto getPath(MType type, std::string name, SubType subType) -> std::string;
+    /** @brief Add the latest sample of the history to the sub-windows */
+    void updateSubWindows();
+    /** @brief Check specified threshold for the given value, against the
+     *         statistic of the window unless it has a sub-window */
+    void checkThreshold(Type type, Bound bound, MValue value,
+                        std::optional<double> statistic);
+    /** @brief Check all thresholds for the given value, with the statistic of
+     *         the window once it has filled */
+    void checkThresholds(MValue value, std::optional<double> statistic);
+    /** @brief Publish the values to the exposition and shared memory */
+    void publish();
+    /** @brief Format the series of the metric in the exposition */
+    void exportValues();
+    /** @brief Update the entry of the metric in the shared memory */
+    void shareValues();
+    /** @brief Get the object path for the given type and config */
+    static auto getPath(MType type, const config::HealthMetric& config)
+        -> std::string;
     /** @brief D-Bus bus connection */
     sdbusplus::bus_t& bus;
     /** @brief Metric type */
     MType type;
-    /** @brief Metric configuration */
-    const config::HealthMetric config;
+    /** @brief Metric configuration, shared with the collection */
+    const config::HealthMetric& config;
     /** @brief Window for metric history */
-    std::deque<double> history;
-    /** @brief Last notified value for the metric change */
-    double lastNotifiedValue = 0;
+    aggregator::Window history;
+    /** @brief Statistic of the window compared against thresholds */
+    std::unique_ptr<aggregator::Aggregator> statistic;
+    /** @brief Sub-windows of the thresholds evaluated on fewer samples */
+    std::pmr::map<std::tuple<Type, Bound>, SubWindow> subWindows;
+    /** @brief Trend of the window for the time to exhaustion */
+    aggregator::Trend trend;
+    /** @brief Histogram of the samples over D-Bus, if configured */
+    std::unique_ptr<HistogramIntf> histogram;
+    /** @brief Config of the time to exhaustion metric, which refers to it */
+    std::unique_ptr<config::HealthMetric> exhaustionConfig;
+    /** @brief Predicted time to exhaustion metric, if configured */
+    std::unique_ptr<HealthMetric> exhaustion;
+    /** @brief Last notified value for the metric change, unset until the
+     *         first value or after the metric was stale */
+    std::optional<double> lastNotifiedValue;
+    /** @brief Monotonic time of the last notified value */
+    std::chrono::steady_clock::time_point lastNotifiedTime;
+    /** @brief The metric value couldn't be read in time */
+    bool stale = false;
+    /** @brief Series in the OpenMetrics exposition, if exported */
+    std::unique_ptr<Exported> exported;
+    /** @brief Shared memory writer, if shared */
+    shm::Writer* shared = nullptr;
+    /** @brief Index of the entry in the shared memory */
+    size_t sharedIndex = 0;
+    /** @brief Snapshotter for the severe assertions, if enabled */
+    snapshot::Snapshotter* snapshotter = nullptr;
 };
 
 } // namespace phosphor::health::metric
@@ -0,0 +1,400 @@
+#include "health_metric_aggregator.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace phosphor::health::metric::aggregator
+{
+
+void Mean::accumulate(double value)
+{
+    auto t = sum + value;
+    if (std::abs(sum) >= std::abs(value))
+    {
+        compensation += (sum - t) + value;
+    }
+    else
+    {
+        compensation += (value - t) + sum;
+    }
+    sum = t;
+}
+
+void Mean::add(double value, std::optional<double> evicted)
+{
+    // The non-finite samples, e.g. of a read which failed, are skipped, as
+    // they would keep the running sum non-finite after their eviction
+    if (evicted && std::isfinite(*evicted))
+    {
+        accumulate(-*evicted);
+        count--;
+    }
+    if (count == 0)
+    {
+        // Start over from an exact sum whenever the window is empty
+        sum = 0;
+        compensation = 0;
+    }
+    if (std::isfinite(value))
+    {
+        accumulate(value);
+        count++;
+    }
+}
+
+auto Mean::value() const -> double
+{
+    if (count == 0)
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    return (sum + compensation) / count;
+}
+
+void EWMA::add(double value, [[maybe_unused]] std::optional<double> evicted)
+{
+    // A non-finite sample would stay in the average for good
+    if (!std::isfinite(value))
+    {
+        return;
+    }
+    average = average ? *average + alpha * (value - *average) : value;
+}
+
+auto EWMA::value() const -> double
+{
+    return average.value_or(std::numeric_limits<double>::quiet_NaN());
+}
+
+void Percentile::reset()
+{
+    count = 0;
+    positions = {1, 2, 3, 4, 5};
+    desired = {1, 1 + 2 * p, 1 + 4 * p, 3 + 2 * p, 5};
+    increments = {0, p / 2, p, (1 + p) / 2, 1};
+}
+
+auto Percentile::parabolic(size_t i, double d) const -> double
+{
+    return heights[i] +
+           d / (positions[i + 1] - positions[i - 1]) *
+               ((positions[i] - positions[i - 1] + d) *
+                    (heights[i + 1] - heights[i]) /
+                    (positions[i + 1] - positions[i]) +
+                (positions[i + 1] - positions[i] - d) *
+                    (heights[i] - heights[i - 1]) /
+                    (positions[i] - positions[i - 1]));
+}
+
+auto Percentile::linear(size_t i, double d) const -> double
+{
+    auto j = (d > 0) ? i + 1 : i - 1;
+    return heights[i] +
+           d * (heights[j] - heights[i]) / (positions[j] - positions[i]);
+}
+
+auto Percentile::estimate() const -> double
+{
+    if (count >= markers)
+    {
+        return heights[2];
+    }
+    if (count == 0)
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    // Not enough samples for the markers yet, use the nearest rank
+    auto samples = heights;
+    std::sort(samples.begin(), samples.begin() + count);
+    auto rank = static_cast<size_t>(std::ceil(p * count));
+    return samples[std::clamp<size_t>(rank, 1, count) - 1];
+}
+
+void Percentile::add(double value,
+                     [[maybe_unused]] std::optional<double> evicted)
+{
+    if (count < markers)
+    {
+        heights[count++] = value;
+        if (count == markers)
+        {
+            std::ranges::sort(heights);
+        }
+    }
+    else
+    {
+        // Find the cell of the sample, extending the extreme markers
+        size_t k = 0;
+        if (value < heights[0])
+        {
+            heights[0] = value;
+        }
+        else if (value >= heights[markers - 1])
+        {
+            heights[markers - 1] = value;
+            k = markers - 2;
+        }
+        else
+        {
+            while (value >= heights[k + 1])
+            {
+                k++;
+            }
+        }
+
+        for (auto i = k + 1; i < markers; i++)
+        {
+            positions[i]++;
+        }
+        for (size_t i = 0; i < markers; i++)
+        {
+            desired[i] += increments[i];
+        }
+
+        // Adjust the middle markers if they are off their desired position
+        for (size_t i = 1; i < markers - 1; i++)
+        {
+            auto d = desired[i] - positions[i];
+            if ((d >= 1 && positions[i + 1] - positions[i] > 1) ||
+                (d <= -1 && positions[i - 1] - positions[i] < -1))
+            {
+                d = std::copysign(1.0, d);
+                auto height = parabolic(i, d);
+                if (heights[i - 1] < height && height < heights[i + 1])
+                {
+                    heights[i] = height;
+                }
+                else
+                {
+                    heights[i] = linear(i, d);
+                }
+                positions[i] += d;
+            }
+        }
+        count++;
+    }
+
+    if (count >= windowSize)
+    {
+        last = estimate();
+        reset();
+    }
+}
+
+auto Percentile::value() const -> double
+{
+    return last.value_or(estimate());
+}
+
+Window::Window(size_t capacity, std::pmr::memory_resource* memory) :
+    samples(std::max<size_t>(capacity, 1), memory)
+{}
+
+auto Window::push(const Sample& sample) -> std::optional<Sample>
+{
+    if (count < samples.size())
+    {
+        samples[(head + count++) % samples.size()] = sample;
+        return std::nullopt;
+    }
+    auto evicted = samples[head];
+    samples[head] = sample;
+    head = (head + 1) % samples.size();
+    return evicted;
+}
+
+auto Window::copy() const -> std::vector<Sample>
+{
+    std::vector<Sample> result;
+    result.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        result.push_back((*this)[i]);
+    }
+    return result;
+}
+
+void Trend::add(const Sample& sample, const std::optional<Sample>& evicted)
+{
+    using seconds_t = std::chrono::duration<double>;
+    if (evicted && count > 0)
+    {
+        auto delta = evicted->timestamp - origin;
+        auto x = seconds_t(delta).count();
+        sumX -= x;
+        sumXX -= x * x;
+        sumY -= evicted->value;
+        sumXY -= x * evicted->value;
+        count--;
+        // Follow the oldest sample, so the times stay small
+        shift(delta);
+    }
+    if (count == 0)
+    {
+        origin = sample.timestamp;
+        sumX = sumXX = sumY = sumXY = 0;
+    }
+
+    lastX = seconds_t(sample.timestamp - origin).count();
+    sumX += lastX;
+    sumXX += lastX * lastX;
+    sumY += sample.value;
+    sumXY += lastX * sample.value;
+    count++;
+}
+
+void Trend::shift(std::chrono::steady_clock::duration delta)
+{
+    auto seconds = std::chrono::duration<double>(delta).count();
+    double n = count;
+    sumXX -= 2 * seconds * sumX - n * seconds * seconds;
+    sumXY -= seconds * sumY;
+    sumX -= n * seconds;
+    lastX -= seconds;
+    origin += delta;
+}
+
+auto Trend::slope() const -> double
+{
+    if (count < 2)
+    {
+        return 0;
+    }
+    double n = count;
+    auto denominator = n * sumXX - sumX * sumX;
+    if (denominator <= 0)
+    {
+        // All the samples are at the same time
+        return 0;
+    }
+    return (n * sumXY - sumX * sumY) / denominator;
+}
+
+auto Trend::fitted() const -> double
+{
+    if (count == 0)
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    double n = count;
+    auto m = slope();
+    auto intercept = (sumY - m * sumX) / n;
+    return intercept + m * lastX;
+}
+
+auto Trend::secondsToZero() const -> double
+{
+    auto m = slope();
+    if (count < 2 || m >= 0)
+    {
+        return std::numeric_limits<double>::infinity();
+    }
+    return std::max(fitted(), 0.0) / -m;
+}
+
+Histogram::Histogram(size_t precision) :
+    buckets(size_t{1} << std::clamp<size_t>(precision, 1, maxPrecision)),
+    counts(1 + (maxExponent - minExponent + 1) * buckets)
+{}
+
+auto Histogram::index(double value) const -> size_t
+{
+    int exponent = 0;
+    // value = mantissa * 2^exponent, with the mantissa in [0.5, 1)
+    auto mantissa = std::frexp(value, &exponent);
+    if (!(value > 0) || exponent < minExponent)
+    {
+        return 0;
+    }
+    if (exponent > maxExponent)
+    {
+        return counts.size() - 1;
+    }
+    auto bucket = static_cast<size_t>((mantissa - 0.5) * 2 * buckets);
+    return 1 + (exponent - minExponent) * buckets + bucket;
+}
+
+auto Histogram::midpoint(size_t index) const -> double
+{
+    if (index == 0)
+    {
+        return 0;
+    }
+    auto exponent = static_cast<int>((index - 1) / buckets) + minExponent;
+    auto bucket = (index - 1) % buckets;
+    return std::ldexp(0.5 + (bucket + 0.5) / (2 * buckets), exponent);
+}
+
+void Histogram::record(double value)
+{
+    if (std::isnan(value))
+    {
+        return;
+    }
+    counts[index(value)]++;
+    total++;
+    if (!(value <= maximum))
+    {
+        maximum = value;
+    }
+}
+
+auto Histogram::percentile(double percentile) const -> double
+{
+    if (total == 0)
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    auto rank = std::max<uint64_t>(
+        1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * total)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); i++)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+        {
+            // The bucket of the maximum doesn't go beyond it
+            return std::min(midpoint(i), maximum);
+        }
+    }
+    return maximum;
+}
+
+void Histogram::reset()
+{
+    std::ranges::fill(counts, 0);
+    total = 0;
+    maximum = std::numeric_limits<double>::quiet_NaN();
+}
+
+auto create(const config::HealthMetric& config) -> std::unique_ptr<Aggregator>
+{
+    switch (config.aggregation)
+    {
+        case Aggregation::ewma:
+        {
+            return std::make_unique<EWMA>(config.windowSize);
+        }
+        case Aggregation::max:
+        {
+            return std::make_unique<Max>(config.windowSize);
+        }
+        case Aggregation::min:
+        {
+            return std::make_unique<Min>(config.windowSize);
+        }
+        case Aggregation::percentile:
+        {
+            return std::make_unique<Percentile>(config.windowSize,
+                                                config.percentile);
+        }
+        case Aggregation::mean:
+        default:
+        {
+            return std::make_unique<Mean>();
+        }
+    }
+}
+
+} // namespace phosphor::health::metric::aggregator
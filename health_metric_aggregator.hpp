@@ -0,0 +1,314 @@
+#pragma once
+
+#include "health_metric_config.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace phosphor::health::metric::aggregator
+{
+
+/** @brief Streaming statistic over the metric window.
+ *
+ *  All aggregators have an O(1) (amortized) cost per sample, so the choice of
+ *  statistic doesn't change the per-tick cost of a metric.
+ */
+class Aggregator
+{
+  public:
+    virtual ~Aggregator() = default;
+
+    /** @brief Add a sample, along with the sample evicted from the window
+     *         once it is full */
+    virtual void add(double value, std::optional<double> evicted) = 0;
+    /** @brief Get the aggregated value */
+    virtual auto value() const -> double = 0;
+};
+
+/** @brief Arithmetic mean of the finite samples of the window, from a
+ *         compensated running sum */
+class Mean : public Aggregator
+{
+  public:
+    void add(double value, std::optional<double> evicted) override;
+    auto value() const -> double override;
+
+  private:
+    /** @brief Add to the running sum with Neumaier compensation */
+    void accumulate(double value);
+    /** @brief Running sum of the window */
+    double sum = 0;
+    /** @brief Compensation for the lost low-order bits of the sum */
+    double compensation = 0;
+    /** @brief Number of finite samples in the window */
+    size_t count = 0;
+};
+
+/** @brief Exponentially weighted moving average of the finite samples, with
+ *         the smoothing factor of a window of the given size */
+class EWMA : public Aggregator
+{
+  public:
+    explicit EWMA(size_t windowSize) : alpha(2.0 / (windowSize + 1.0)) {}
+
+    void add(double value, std::optional<double> evicted) override;
+    auto value() const -> double override;
+
+  private:
+    /** @brief Smoothing factor */
+    double alpha;
+    /** @brief Current average */
+    std::optional<double> average;
+};
+
+/** @brief Sliding maximum or minimum of the window, using a monotonic deque */
+template <typename Compare>
+class Extremum : public Aggregator
+{
+  public:
+    explicit Extremum(size_t windowSize) : windowSize(windowSize) {}
+
+    void add(double value, [[maybe_unused]] std::optional<double> evicted)
+        override
+    {
+        // Drop the samples which can never be the extremum again
+        while (!window.empty() && !Compare{}(window.back().second, value))
+        {
+            window.pop_back();
+        }
+        window.emplace_back(sequence, value);
+        if (window.front().first + windowSize <= sequence)
+        {
+            window.pop_front();
+        }
+        sequence++;
+    }
+
+    auto value() const -> double override
+    {
+        return window.empty() ? std::numeric_limits<double>::quiet_NaN()
+                              : window.front().second;
+    }
+
+  private:
+    /** @brief Window size */
+    size_t windowSize;
+    /** @brief Sequence number of the next sample */
+    uint64_t sequence = 0;
+    /** @brief Candidate samples with their sequence number */
+    std::deque<std::pair<uint64_t, double>> window;
+};
+
+using Max = Extremum<std::greater<double>>;
+using Min = Extremum<std::less<double>>;
+
+/** @brief Quantile estimate using the P-square algorithm (Jain & Chlamtac).
+ *
+ *  The estimate is made over tumbling windows of the given size with five
+ *  markers, so it uses constant memory regardless of the window size. The
+ *  value is the estimate of the last completed window, so unlike the other
+ *  aggregators it doesn't slide with each sample: the evicted samples are
+ *  ignored, and the value changes once per window.
+ */
+class Percentile : public Aggregator
+{
+  public:
+    Percentile(size_t windowSize, double percentile) :
+        windowSize(windowSize), p(percentile / 100.0)
+    {
+        reset();
+    }
+
+    void add(double value, std::optional<double> evicted) override;
+    auto value() const -> double override;
+
+  private:
+    static constexpr size_t markers = 5;
+
+    /** @brief Restart the estimate for a new window */
+    void reset();
+    /** @brief Current estimate of the quantile */
+    auto estimate() const -> double;
+    /** @brief Piecewise-parabolic prediction for marker adjustment */
+    auto parabolic(size_t i, double d) const -> double;
+    /** @brief Linear prediction for marker adjustment */
+    auto linear(size_t i, double d) const -> double;
+
+    /** @brief Window size */
+    size_t windowSize;
+    /** @brief Quantile to be estimated */
+    double p;
+    /** @brief Number of samples in the current window */
+    size_t count = 0;
+    /** @brief Marker heights */
+    std::array<double, markers> heights{};
+    /** @brief Marker positions */
+    std::array<double, markers> positions{};
+    /** @brief Desired marker positions */
+    std::array<double, markers> desired{};
+    /** @brief Increments of the desired marker positions */
+    std::array<double, markers> increments{};
+    /** @brief Estimate of the last completed window */
+    std::optional<double> last;
+};
+
+/** @brief Sample of a metric, with its monotonic timestamp */
+struct Sample
+{
+    /** @brief Time at which the sample was read */
+    std::chrono::steady_clock::time_point timestamp;
+    /** @brief Value of the sample */
+    double value;
+};
+
+/** @brief Window of the latest samples of a metric.
+ *
+ *  The samples are kept in a ring buffer allocated once, at the window size,
+ *  from the memory resource, so adding a sample never allocates and a
+ *  monotonic arena can back the windows of many metrics.
+ */
+class Window
+{
+  public:
+    Window(size_t capacity, std::pmr::memory_resource* memory);
+
+    /** @brief Add a sample, and get the oldest sample if it was evicted to
+     *         make room for it */
+    auto push(const Sample& sample) -> std::optional<Sample>;
+    /** @brief Get the sample at the index, from the oldest */
+    auto operator[](size_t index) const -> const Sample&
+    {
+        return samples[(head + index) % samples.size()];
+    }
+    /** @brief Get the latest sample */
+    auto back() const -> const Sample&
+    {
+        return (*this)[count - 1];
+    }
+    /** @brief Get the number of samples */
+    auto size() const -> size_t
+    {
+        return count;
+    }
+    /** @brief Copy the samples, from the oldest */
+    auto copy() const -> std::vector<Sample>;
+
+  private:
+    /** @brief Ring buffer of the samples */
+    std::pmr::vector<Sample> samples;
+    /** @brief Index of the oldest sample */
+    size_t head = 0;
+    /** @brief Number of samples, up to the capacity */
+    size_t count = 0;
+};
+
+/** @brief Least-squares linear trend of the window, against time.
+ *
+ *  The sums are maintained incrementally, which is O(1) per sample. Times
+ *  are in seconds from an origin which follows the oldest sample of the
+ *  window, so they stay small and the sums don't lose precision over the
+ *  lifetime of the monitor.
+ */
+class Trend
+{
+  public:
+    /** @brief Add a sample, along with the sample evicted from the window
+     *         once it is full */
+    void add(const Sample& sample, const std::optional<Sample>& evicted);
+    /** @brief Get the slope, in value per second */
+    auto slope() const -> double;
+    /** @brief Get the fitted value at the latest sample */
+    auto fitted() const -> double;
+    /** @brief Get the seconds until the fitted value reaches zero, infinity
+     *         if it isn't decreasing */
+    auto secondsToZero() const -> double;
+
+  private:
+    /** @brief Move the time origin of the sums */
+    void shift(std::chrono::steady_clock::duration delta);
+
+    /** @brief Time origin of the sums */
+    std::chrono::steady_clock::time_point origin;
+    /** @brief Number of samples */
+    size_t count = 0;
+    /** @brief Sum of the sample times */
+    double sumX = 0;
+    /** @brief Sum of the squared sample times */
+    double sumXX = 0;
+    /** @brief Sum of the samples */
+    double sumY = 0;
+    /** @brief Sum of the samples weighted by their time */
+    double sumXY = 0;
+    /** @brief Time of the latest sample */
+    double lastX = 0;
+};
+
+/** @brief Log-linear histogram of all the samples since it was reset, in the
+ *         style of HDR histograms.
+ *
+ *  Each power of two range of values is split into 2^precision linear
+ *  buckets, so a percentile is within 2^-precision of the exact one. The
+ *  counters are allocated once for the whole range of a double the metrics
+ *  can take, so recording a sample is O(1) with a fixed memory.
+ */
+class Histogram
+{
+  public:
+    /** @brief Highest precision, in bits of the bucket of a value */
+    static constexpr size_t maxPrecision = 7;
+
+    explicit Histogram(size_t precision);
+
+    /** @brief Record a sample */
+    void record(double value);
+    /** @brief Get the percentile of the samples, NaN if there are none */
+    auto percentile(double percentile) const -> double;
+    /** @brief Get the maximum of the samples, NaN if there are none */
+    auto max() const -> double
+    {
+        return maximum;
+    }
+    /** @brief Get the number of samples */
+    auto count() const -> uint64_t
+    {
+        return total;
+    }
+    /** @brief Drop all the samples */
+    void reset();
+
+  private:
+    /** @brief Exponent of the lowest power of two range, values below it
+     *         are counted as zero */
+    static constexpr int minExponent = -6;
+    /** @brief Exponent of the highest power of two range, values above it
+     *         are counted in its last bucket */
+    static constexpr int maxExponent = 64;
+
+    /** @brief Get the bucket of a value */
+    auto index(double value) const -> size_t;
+    /** @brief Get the value a bucket stands for, its midpoint */
+    auto midpoint(size_t index) const -> double;
+
+    /** @brief Linear buckets per power of two range */
+    size_t buckets;
+    /** @brief Samples by bucket, the first one for zero */
+    std::vector<uint32_t> counts;
+    /** @brief Number of samples */
+    uint64_t total = 0;
+    /** @brief Maximum of the samples */
+    double maximum = std::numeric_limits<double>::quiet_NaN();
+};
+
+/** @brief Create the aggregator for the metric config */
+auto create(const config::HealthMetric& config) -> std::unique_ptr<Aggregator>;
+
+} // namespace phosphor::health::metric::aggregator
@@ -1,234 +1,166 @@
 #include "health_metric_collection.hpp"
 
-#include <phosphor-logging/lg2.hpp>
+#include "health_log_throttle.hpp"
+#include "health_trace.hpp"
 
-#include <fstream>
-#include <numeric>
-#include <unordered_map>
+#include <phosphor-logging/lg2.hpp>
 
-extern "C"
-{
-#include <sys/statvfs.h>
-}
+#include <concepts>
+#include <type_traits>
 
 PHOSPHOR_LOG2_USING;
 
 namespace phosphor::health::metric::collection
 {
 
-auto HealthMetricCollection::readCPU() -> bool
+namespace
 {
-    enum CPUStatsIndex
-    {
-        userIndex = 0,
-        niceIndex,
-        systemIndex,
-        idleIndex,
-        iowaitIndex,
-        irqIndex,
-        softirqIndex,
-        stealIndex,
-        guestUserIndex,
-        guestNiceIndex,
-        maxIndex
-    };
-    constexpr auto procStat = "/proc/stat";
-    std::ifstream fileStat(procStat);
-    if (!fileStat.is_open())
-    {
-        error("Unable to open {PATH} for reading CPU stats", "PATH", procStat);
-        return false;
-    }
 
-    std::string firstLine, labelName;
-    std::size_t timeData[CPUStatsIndex::maxIndex] = {0};
+/** @brief Emplace the collector of the metric type from the registry */
+template <typename Variant, typename... Ts>
+void emplaceCollector(Variant& collector, MetricIntf::Type type,
+                      const Context& context,
+                      std::type_identity<std::tuple<Ts...>>)
+{
+    auto emplace = [&]<typename T>() {
+        if (T::type != type)
+        {
+            return false;
+        }
+        collector.template emplace<T>(context);
+        return true;
+    };
+    (emplace.template operator()<Ts>() || ...);
+}
 
-    std::getline(fileStat, firstLine);
-    std::stringstream ss(firstLine);
-    ss >> labelName;
+/** @brief Call the function with the collector, if there is one */
+template <typename Variant, typename F>
+void visitCollector(Variant& collector, F&& f)
+{
+    std::visit(
+        [&](auto& c) {
+            if constexpr (!std::same_as<std::remove_cvref_t<decltype(c)>,
+                                        std::monostate>)
+            {
+                f(c);
+            }
+        },
+        collector);
+}
 
-    if (labelName.compare("cpu"))
+/** @brief Collect the metrics of a collector, awaiting it if it is
+ *         asynchronous */
+template <CollectorType T>
+auto collectFrom(T& collector, sdbusplus::async::context& ctx)
+    -> sdbusplus::async::task<bool>
+{
+    if constexpr (AsyncCollector<T>)
     {
-        error("CPU data not available");
-        return false;
+        co_return co_await collector.collect(ctx);
     }
-
-    for (auto idx = 0; idx < CPUStatsIndex::maxIndex; idx++)
+    else
     {
-        if (!(ss >> timeData[idx]))
-        {
-            error("CPU data not correct");
-            return false;
-        }
+        co_return collector.collect();
     }
+}
 
-    for (auto& config : configs)
-    {
-        uint64_t activeTime = 0, activeTimeDiff = 0, totalTime = 0,
-                 totalTimeDiff = 0;
-        double activePercValue = 0;
-
-        if (config.subType == MetricIntf::SubType::cpuTotal)
-        {
-            activeTime = timeData[CPUStatsIndex::userIndex] +
-                         timeData[CPUStatsIndex::niceIndex] +
-                         timeData[CPUStatsIndex::systemIndex] +
-                         timeData[CPUStatsIndex::irqIndex] +
-                         timeData[CPUStatsIndex::softirqIndex] +
-                         timeData[CPUStatsIndex::stealIndex] +
-                         timeData[CPUStatsIndex::guestUserIndex] +
-                         timeData[CPUStatsIndex::guestNiceIndex];
-        }
-        else if (config.subType == MetricIntf::SubType::cpuKernel)
-        {
-            activeTime = timeData[CPUStatsIndex::systemIndex];
-        }
-        else if (config.subType == MetricIntf::SubType::cpuUser)
-        {
-            activeTime = timeData[CPUStatsIndex::userIndex];
-        }
-
-        totalTime = std::accumulate(std::begin(timeData), std::end(timeData),
-                                    decltype(totalTime){0});
-
-        activeTimeDiff = activeTime - preActiveTime[config.subType];
-        totalTimeDiff = totalTime - preTotalTime[config.subType];
+auto collectFrom(std::monostate&, sdbusplus::async::context&)
+    -> sdbusplus::async::task<bool>
+{
+    co_return false;
+}
 
-        /* Store current active and total time for next calculation */
-        preActiveTime[config.subType] = activeTime;
-        preTotalTime[config.subType] = totalTime;
+} // namespace
 
-        activePercValue = (100.0 * activeTimeDiff) / totalTimeDiff;
-        debug("CPU Metric {SUBTYPE}: {VALUE}", "SUBTYPE", config.subType,
-              "VALUE", (double)activePercValue);
-        /* For CPU, both user and monitor uses percentage values */
-        metrics[config.name]->update(MValue(activePercValue, 100));
+HealthMetricCollection::HealthMetricCollection(
+    sdbusplus::bus_t& bus, MetricIntf::Type type, const configs_t& configs,
+    MetricIntf::paths_t& bmcPaths, reader::BatchReader& reader) : type(type)
+{
+    emplaceCollector(collector, type,
+                     Context{.bus = bus,
+                             .configs = configs,
+                             .bmcPaths = bmcPaths,
+                             .reader = reader},
+                     std::type_identity<Collectors>{});
+    if (std::holds_alternative<std::monostate>(collector))
+    {
+        error("Unknown health metric type {TYPE}", "TYPE", type);
     }
-    return true;
 }
 
-auto HealthMetricCollection::readMemory() -> bool
+auto HealthMetricCollection::read(sdbusplus::async::context& ctx)
+    -> sdbusplus::async::task<>
 {
-    constexpr auto procMeminfo = "/proc/meminfo";
-    std::ifstream memInfo(procMeminfo);
-    if (!memInfo.is_open())
+    if (std::holds_alternative<std::monostate>(collector))
     {
-        error("Unable to open {PATH} for reading Memory stats", "PATH",
-              procMeminfo);
-        return false;
+        co_return;
     }
-    std::string line;
-    std::unordered_map<MetricIntf::SubType, double> memoryValues;
 
-    while (std::getline(memInfo, line))
+    auto& throttle = throttle::logThrottle();
+    auto key = "collect " + MetricIntf::to_string(type);
+    HEALTH_TRACE(collection_start, static_cast<int>(type));
+    auto ok = co_await std::visit(
+        [&ctx](auto& collector) { return collectFrom(collector, ctx); },
+        collector);
+    HEALTH_TRACE(collection_end, static_cast<int>(type), ok);
+    if (ok)
     {
-        std::string name;
-        double value;
-        std::istringstream iss(line);
-
-        if (!(iss >> name >> value))
-        {
-            continue;
-        }
-        if (name.starts_with("MemAvailable"))
-        {
-            memoryValues[MetricIntf::SubType::memoryAvailable] = value;
-        }
-        else if (name.starts_with("MemFree"))
-        {
-            memoryValues[MetricIntf::SubType::memoryFree] = value;
-        }
-        else if (name.starts_with("Buffers") || name.starts_with("Cached"))
-        {
-            memoryValues[MetricIntf::SubType::memoryBufferedAndCached] += value;
-        }
-        else if (name.starts_with("MemTotal"))
-        {
-            memoryValues[MetricIntf::SubType::memoryTotal] = value;
-        }
-        else if (name.starts_with("Shmem"))
-        {
-            memoryValues[MetricIntf::SubType::memoryShared] += value;
-        }
+        throttle.clear(key);
     }
-
-    for (auto& config : configs)
+    else if (throttle.admit(key))
     {
-        // Convert kB to Bytes
-        auto value = memoryValues.at(config.subType) * 1024;
-        auto total = memoryValues.at(MetricIntf::SubType::memoryTotal) * 1024;
-        debug("Memory Metric {SUBTYPE}: {VALUE}, {TOTAL}", "SUBTYPE",
-              config.subType, "VALUE", value, "TOTAL", total);
-        metrics[config.name]->update(MValue(value, total));
+        error("Failed to read {TYPE} health metric", "TYPE", type);
     }
-    return true;
 }
 
-auto HealthMetricCollection::readStorage() -> bool
+void HealthMetricCollection::updateAssociations(
+    const MetricIntf::paths_t& bmcPaths)
 {
-    for (auto& config : configs)
-    {
-        struct statvfs buffer;
-        if (statvfs(config.path.c_str(), &buffer) != 0)
-        {
-            auto e = errno;
-            error("Error from statvfs: {ERROR}, path: {PATH}", "ERROR",
-                  strerror(e), "PATH", config.path);
-            continue;
-        }
-        double value = buffer.f_bfree * buffer.f_frsize;
-        double total = buffer.f_blocks * buffer.f_frsize;
-        debug("Storage Metric {SUBTYPE}: {VALUE}, {TOTAL}", "SUBTYPE",
-              config.subType, "VALUE", value, "TOTAL", total);
-        metrics[config.name]->update(MValue(value, total));
-    }
-    return true;
+    visitCollector(collector, [&](auto& collector) {
+        collector.updateAssociations(bmcPaths);
+    });
+}
+
+void HealthMetricCollection::exportTo(exporter::Exposition& exposition)
+{
+    visitCollector(collector, [&](auto& collector) {
+        collector.exportTo(exposition);
+    });
 }
 
-void HealthMetricCollection::read()
+void HealthMetricCollection::shareTo(shm::Writer& writer)
 {
-    switch (type)
+    visitCollector(collector,
+                   [&](auto& collector) { collector.shareTo(writer); });
+}
+
+void HealthMetricCollection::snapshotTo(snapshot::Snapshotter& snapshotter)
+{
+    visitCollector(collector, [&](auto& collector) {
+        collector.snapshotTo(snapshotter);
+    });
+}
+
+void HealthMetricCollection::announce()
+{
+    visitCollector(collector, [](auto& collector) { collector.announce(); });
+}
+
+auto HealthMetricCollection::services() const -> std::vector<std::string>
+{
+    if (auto* process = std::get_if<ProcessCollector>(&collector))
     {
-        case MetricIntf::Type::cpu:
-        {
-            if (!readCPU())
-            {
-                error("Failed to read CPU health metric");
-            }
-            break;
-        }
-        case MetricIntf::Type::memory:
-        {
-            if (!readMemory())
-            {
-                error("Failed to read memory health metric");
-            }
-            break;
-        }
-        case MetricIntf::Type::storage:
-        {
-            if (!readStorage())
-            {
-                error("Failed to read storage health metric");
-            }
-            break;
-        }
-        default:
-        {
-            error("Unknown health metric type {TYPE}", "TYPE", type);
-            break;
-        }
+        return process->services();
     }
+    return {};
 }
 
-void HealthMetricCollection::create(const MetricIntf::paths_t& bmcPaths)
+void HealthMetricCollection::updatePid(const std::string& service,
+                                       uint32_t pid)
 {
-    metrics.clear();
-
-    for (auto& config : configs)
+    if (auto* process = std::get_if<ProcessCollector>(&collector))
     {
-        metrics[config.name] = std::make_unique<MetricIntf::HealthMetric>(
-            bus, type, config, bmcPaths);
+        process->updatePid(service, pid);
     }
 }
 
@@ -1,52 +1,64 @@
 #pragma once
 
-#include "health_metric.hpp"
+#include "health_metric_collectors.hpp"
+
+#include <sdbusplus/async.hpp>
+
+#include <string>
+#include <variant>
+#include <vector>
 
 namespace phosphor::health::metric::collection
 {
-namespace ConfigIntf = phosphor::health::metric::config;
-namespace MetricIntf = phosphor::health::metric;
-
-using configs_t = std::vector<ConfigIntf::HealthMetric>;
 
 class HealthMetricCollection
 {
   public:
     HealthMetricCollection(sdbusplus::bus_t& bus, MetricIntf::Type type,
                            const configs_t& configs,
-                           MetricIntf::paths_t& bmcPaths) :
-        bus(bus), type(type), configs(configs)
-    {
-        create(bmcPaths);
-    }
+                           MetricIntf::paths_t& bmcPaths,
+                           reader::BatchReader& reader);
+
+    /** @brief Emit the InterfacesAdded signals for all metrics */
+    void announce();
+
+    /** @brief Read the health metric collection from the system, awaiting
+     *         the I/O of the collector on the context */
+    auto read(sdbusplus::async::context& ctx) -> sdbusplus::async::task<>;
+
+    /** @brief Update the BMC inventory paths for all metrics */
+    void updateAssociations(const MetricIntf::paths_t& bmcPaths);
 
-    /** @brief Read the health metric collection from the system */
-    void read();
+    /** @brief Add all metrics to the OpenMetrics exposition */
+    void exportTo(exporter::Exposition& exposition);
+
+    /** @brief Add all metrics to the shared memory segment */
+    void shareTo(shm::Writer& writer);
+
+    /** @brief Capture snapshots when severe thresholds of the metrics
+     *         assert */
+    void snapshotTo(snapshot::Snapshotter& snapshotter);
+
+    /** @brief Get the systemd services measured by the process metrics */
+    auto services() const -> std::vector<std::string>;
+
+    /** @brief Update the main PID of a service, 0 if it isn't running */
+    void updatePid(const std::string& service, uint32_t pid);
 
   private:
-    using map_t = std::unordered_map<std::string,
-                                     std::unique_ptr<MetricIntf::HealthMetric>>;
-    using time_map_t = std::unordered_map<MetricIntf::SubType, uint64_t>;
-    /** @brief Create a new health metric collection object */
-    void create(const MetricIntf::paths_t& bmcPaths);
-    /** @brief Read the CPU */
-    auto readCPU() -> bool;
-    /** @brief Read the memory */
-    auto readMemory() -> bool;
-    /** @brief Read the storage */
-    auto readStorage() -> bool;
-    /** @brief D-Bus bus connection */
-    sdbusplus::bus_t& bus;
+    template <typename>
+    struct variant_of;
+    template <typename... Ts>
+    struct variant_of<std::tuple<Ts...>>
+    {
+        static_assert((CollectorType<Ts> && ...));
+        using type = std::variant<std::monostate, Ts...>;
+    };
+
     /** @brief Metric type */
     MetricIntf::Type type;
-    /** @brief Health metric configs */
-    const configs_t& configs;
-    /** @brief Map of health metrics by subtype */
-    map_t metrics;
-    /** @brief Map for active time by subtype */
-    time_map_t preActiveTime;
-    /** @brief Map for total time by subtype */
-    time_map_t preTotalTime;
+    /** @brief Collector of the metric type, from the registry */
+    variant_of<Collectors>::type collector;
 };
 
 } // namespace phosphor::health::metric::collection
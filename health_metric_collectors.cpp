@@ -0,0 +1,1082 @@
+#include "config.h"
+
+#include "health_metric_collectors.hpp"
+
+#include "health_log_throttle.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <initializer_list>
+#include <map>
+#include <numeric>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+extern "C"
+{
+#include <sys/statvfs.h>
+#include <unistd.h>
+}
+
+PHOSPHOR_LOG2_USING;
+
+namespace phosphor::health::metric::collection
+{
+
+using phosphor::health::throttle::logThrottle;
+
+namespace
+{
+
+constexpr auto cgroupRoot = "/sys/fs/cgroup/system.slice";
+constexpr auto procStat = "/proc/stat";
+constexpr auto procMeminfo = "/proc/meminfo";
+constexpr auto procFileNr = "/proc/sys/fs/file-nr";
+constexpr auto procPidMax = "/proc/sys/kernel/pid_max";
+constexpr auto procLoadavg = "/proc/loadavg";
+constexpr auto procVmstat = "/proc/vmstat";
+/** @brief /proc/stat has long per-CPU and interrupt lines before ctxt */
+constexpr size_t procStatSize = 32768;
+/** @brief /proc/vmstat has a line for each of its many counters */
+constexpr size_t procVmstatSize = 16384;
+/** @brief Buffer sizes for the small cgroup files */
+constexpr size_t cpuStatSize = 512;
+constexpr size_t memoryValueSize = 64;
+/** @brief Buffer sizes for the process files */
+constexpr size_t statmSize = 128;
+constexpr size_t smapsRollupSize = 1024;
+constexpr auto blockingReadTimeout =
+    std::chrono::seconds(BLOCKING_READ_TIMEOUT);
+constexpr auto storageWorkerThreads = 2;
+/** @brief Workers for the statvfs of the mounts, of which as many can hang */
+constexpr auto storageMaxWorkerThreads = 8;
+/** @brief Time a collection waits for the statvfs results */
+constexpr auto storageWaitBudget =
+    std::chrono::milliseconds(MONITOR_COLLECTION_INTERVAL * 1000) / 2;
+
+/** @brief Get the systemd services with a cgroup in the slice */
+auto cgroupServices(const std::string& root) -> std::vector<std::string>
+{
+    std::vector<std::string> services;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(root, ec))
+    {
+        auto name = entry.path().filename().string();
+        if (entry.is_directory(ec) && name.ends_with(".service"))
+        {
+            services.emplace_back(std::move(name));
+        }
+    }
+    std::ranges::sort(services);
+    return services;
+}
+
+/** @brief Instantiate a template unit target, e.g. "restart@.service", for
+ *         the service */
+auto serviceTarget(const std::string& target, const std::string& service)
+    -> std::string
+{
+    auto pos = target.find("@.");
+    if (pos == std::string::npos)
+    {
+        return target;
+    }
+    return target.substr(0, pos + 1) + service + target.substr(pos + 1);
+}
+
+/** @brief Parse an unsigned value, "max" is reported as no value */
+auto parseValue(std::string_view content) -> std::optional<uint64_t>
+{
+    uint64_t value = 0;
+    auto [ptr, ec] =
+        std::from_chars(content.data(), content.data() + content.size(), value);
+    if (ec != std::errc())
+    {
+        return std::nullopt;
+    }
+    return value;
+}
+
+/** @brief Pop the next whitespace separated field from the line */
+auto nextField(std::string_view& line) -> std::string_view
+{
+    auto start = line.find_first_not_of(" \t");
+    if (start == std::string_view::npos)
+    {
+        line = {};
+        return {};
+    }
+    line.remove_prefix(start);
+    auto field = line.substr(0, line.find_first_of(" \t"));
+    line.remove_prefix(field.size());
+    return field;
+}
+
+enum CPUStatsIndex
+{
+    userIndex = 0,
+    niceIndex,
+    systemIndex,
+    idleIndex,
+    iowaitIndex,
+    irqIndex,
+    softirqIndex,
+    stealIndex,
+    guestUserIndex,
+    guestNiceIndex,
+    maxIndex
+};
+
+/** @brief Fields of /proc/stat used by the collections */
+struct ProcStat
+{
+    /** @brief Aggregate CPU times of the "cpu" line */
+    std::optional<std::array<uint64_t, CPUStatsIndex::maxIndex>> cpu;
+    /** @brief Context switches since boot */
+    std::optional<uint64_t> contextSwitches;
+    /** @brief Forks since boot */
+    std::optional<uint64_t> forks;
+};
+
+/** @brief Parse /proc/stat in a single pass over its lines */
+auto parseProcStat(std::string_view content) -> ProcStat
+{
+    ProcStat stat;
+    while (!content.empty())
+    {
+        auto line = content.substr(0, content.find('\n'));
+        content.remove_prefix(std::min(line.size() + 1, content.size()));
+
+        auto name = nextField(line);
+        if (name == "cpu")
+        {
+            std::array<uint64_t, CPUStatsIndex::maxIndex> times{};
+            auto valid = std::ranges::all_of(times, [&](auto& time) {
+                auto value = parseValue(nextField(line));
+                time = value.value_or(0);
+                return value.has_value();
+            });
+            if (valid)
+            {
+                stat.cpu = times;
+            }
+        }
+        else if (name == "ctxt")
+        {
+            stat.contextSwitches = parseValue(nextField(line));
+        }
+        else if (name == "processes")
+        {
+            stat.forks = parseValue(nextField(line));
+        }
+    }
+    return stat;
+}
+
+/** @brief Fields of /proc/meminfo used by the memory metrics */
+enum MeminfoField
+{
+    memTotal = 0,
+    memFree,
+    memAvailable,
+    buffers,
+    cached,
+    shmem,
+    swapTotal,
+    swapFree,
+    meminfoFields
+};
+
+constexpr std::array<std::string_view, meminfoFields> meminfoNames = {
+    "MemTotal:", "MemFree:", "MemAvailable:", "Buffers:",
+    "Cached:",   "Shmem:",   "SwapTotal:",    "SwapFree:"};
+
+/** @brief Parse the fields used by the memory metrics from /proc/meminfo, in
+ *         kB */
+auto parseMeminfo(std::string_view content)
+    -> std::array<double, meminfoFields>
+{
+    std::array<double, meminfoFields> values{};
+    while (!content.empty())
+    {
+        auto line = content.substr(0, content.find('\n'));
+        content.remove_prefix(std::min(line.size() + 1, content.size()));
+
+        auto field = std::ranges::find(meminfoNames, nextField(line));
+        if (field != meminfoNames.end())
+        {
+            values[field - meminfoNames.begin()] =
+                parseValue(nextField(line)).value_or(0);
+        }
+    }
+    return values;
+}
+
+/** @brief Parse a decimal value, like the load averages */
+auto parseDouble(std::string_view content) -> std::optional<double>
+{
+    double value = 0;
+    auto [ptr, ec] =
+        std::from_chars(content.data(), content.data() + content.size(), value);
+    if (ec != std::errc())
+    {
+        return std::nullopt;
+    }
+    return value;
+}
+
+/** @brief Parse the value for the key in a flat keyed file like cpu.stat or
+ *         smaps_rollup */
+auto parseKeyed(std::string_view content, std::string_view key)
+    -> std::optional<uint64_t>
+{
+    while (!content.empty())
+    {
+        auto line = content.substr(0, content.find('\n'));
+        content.remove_prefix(std::min(line.size() + 1, content.size()));
+        if (line.starts_with(key) && line.size() > key.size() &&
+            line[key.size()] == ' ')
+        {
+            line.remove_prefix(key.size());
+            return parseValue(nextField(line));
+        }
+    }
+    return std::nullopt;
+}
+
+} // namespace
+
+CPUCollector::CPUCollector(const Context& context) :
+    Collector(context), reader(context.reader),
+    slot(reader.add(procStat, procStatSize))
+{
+    auto mask = [](std::initializer_list<CPUStatsIndex> indexes) {
+        uint32_t mask = 0;
+        for (auto index : indexes)
+        {
+            mask |= 1u << index;
+        }
+        return mask;
+    };
+
+    for (auto& config : context.configs)
+    {
+        uint32_t active = 0;
+        switch (config.subType)
+        {
+            case MetricIntf::SubType::cpuTotal:
+                active = mask({userIndex, niceIndex, systemIndex, irqIndex,
+                               softirqIndex, stealIndex, guestUserIndex,
+                               guestNiceIndex});
+                break;
+            case MetricIntf::SubType::cpuKernel:
+                active = mask({systemIndex});
+                break;
+            case MetricIntf::SubType::cpuUser:
+                active = mask({userIndex});
+                break;
+            default:
+                error("Invalid CPU metric {SUBTYPE}", "SUBTYPE",
+                      config.subType);
+                continue;
+        }
+        entries.push_back({.metric = &addMetric(context, config),
+                           .active = active});
+    }
+}
+
+auto CPUCollector::collect() -> bool
+{
+    // Parsed once per cycle, along with the counters of the kernel metrics
+    const auto* stat = reader.parse(slot, parseProcStat);
+    if (stat == nullptr)
+    {
+        if (logThrottle().admit("cpu read"))
+        {
+            error("Unable to read {PATH} for CPU stats", "PATH", procStat);
+        }
+        return false;
+    }
+
+    if (!stat->cpu)
+    {
+        if (logThrottle().admit("cpu parse"))
+        {
+            error("CPU data not correct");
+        }
+        return false;
+    }
+    const auto& timeData = *stat->cpu;
+    auto totalTime = std::accumulate(timeData.begin(), timeData.end(),
+                                     uint64_t{0});
+
+    for (auto& entry : entries)
+    {
+        uint64_t activeTime = 0;
+        for (size_t index = 0; index < timeData.size(); index++)
+        {
+            activeTime += ((entry.active >> index) & 1) * timeData[index];
+        }
+
+        auto activeTimeDiff = activeTime - entry.preActiveTime;
+        auto totalTimeDiff = totalTime - entry.preTotalTime;
+
+        /* Store current active and total time for next calculation */
+        entry.preActiveTime = activeTime;
+        entry.preTotalTime = totalTime;
+
+        double activePercValue = (100.0 * activeTimeDiff) / totalTimeDiff;
+        debug("CPU Metric {NAME}: {VALUE}", "NAME", entry.metric->name(),
+              "VALUE", activePercValue);
+        /* For CPU, both user and monitor uses percentage values */
+        entry.metric->update(MValue(activePercValue, 100, reader.timestamp()));
+    }
+    return true;
+}
+
+MemoryCollector::MemoryCollector(const Context& context) :
+    Collector(context), reader(context.reader), slot(reader.add(procMeminfo))
+{
+    auto mask = [](std::initializer_list<MeminfoField> fields) {
+        uint32_t mask = 0;
+        for (auto field : fields)
+        {
+            mask |= 1u << field;
+        }
+        return mask;
+    };
+
+    for (auto& config : context.configs)
+    {
+        uint32_t fields = 0;
+        size_t total = memTotal;
+        switch (config.subType)
+        {
+            case MetricIntf::SubType::memoryAvailable:
+                fields = mask({memAvailable});
+                break;
+            case MetricIntf::SubType::memoryBufferedAndCached:
+                fields = mask({buffers, cached});
+                break;
+            case MetricIntf::SubType::memoryFree:
+                fields = mask({memFree});
+                break;
+            case MetricIntf::SubType::memoryShared:
+                fields = mask({shmem});
+                break;
+            case MetricIntf::SubType::memoryTotal:
+                fields = mask({memTotal});
+                break;
+            case MetricIntf::SubType::memorySwapFree:
+                fields = mask({swapFree});
+                total = swapTotal;
+                break;
+            case MetricIntf::SubType::memorySwapTotal:
+                fields = mask({swapTotal});
+                total = swapTotal;
+                break;
+            default:
+                error("Invalid memory metric {SUBTYPE}", "SUBTYPE",
+                      config.subType);
+                continue;
+        }
+        entries.push_back({.metric = &addMetric(context, config),
+                           .fields = fields,
+                           .total = total});
+    }
+}
+
+auto MemoryCollector::collect() -> bool
+{
+    auto content = reader.get(slot);
+    if (!content)
+    {
+        if (logThrottle().admit("memory read"))
+        {
+            error("Unable to read {PATH} for Memory stats", "PATH",
+                  procMeminfo);
+        }
+        return false;
+    }
+
+    auto values = parseMeminfo(*content);
+    for (auto& entry : entries)
+    {
+        // Convert kB to Bytes
+        auto total = values[entry.total] * 1024;
+        // Without swap, the swap metrics have nothing to be relative to
+        if (total == 0)
+        {
+            continue;
+        }
+        double value = 0;
+        for (size_t field = 0; field < values.size(); field++)
+        {
+            value += ((entry.fields >> field) & 1) * values[field];
+        }
+        value *= 1024;
+        debug("Memory Metric {NAME}: {VALUE}, {TOTAL}", "NAME",
+              entry.metric->name(), "VALUE", value, "TOTAL", total);
+        entry.metric->update(MValue(value, total, reader.timestamp()));
+    }
+    return true;
+}
+
+StorageCollector::StorageCollector(const Context& context) :
+    Collector(context), context(context),
+    workers(storageWorkerThreads, storageMaxWorkerThreads)
+{
+    for (auto& config : context.configs)
+    {
+        if (config.subType == MetricIntf::SubType::storageMounts)
+        {
+            discoveries.push_back(
+                {.config = config,
+                 .filter = mounts::Filter(config.include, config.exclude)});
+            continue;
+        }
+        entries.push_back(
+            {.metric = &addMetric(context, config), .path = config.path});
+    }
+
+    if (!discoveries.empty())
+    {
+        mountTable.emplace();
+        discover();
+    }
+}
+
+void StorageCollector::discover()
+{
+    auto table = mountTable->read();
+    // A mount hides the earlier ones on the same mount point
+    std::map<std::string_view, const mounts::Mount*> visible;
+    for (const auto& mount : table)
+    {
+        visible.insert_or_assign(mount.point, &mount);
+    }
+
+    for (auto& entry : entries)
+    {
+        if (entry.discovered)
+        {
+            entry.mounted = visible.contains(entry.path);
+        }
+    }
+
+    for (const auto& [point, mount] : visible)
+    {
+        auto discovery = std::ranges::find_if(
+            discoveries, [mount](const auto& discovery) {
+                return discovery.filter.matches(*mount);
+            });
+        // The configured paths aren't discovered again
+        if (discovery == discoveries.end() ||
+            std::ranges::any_of(entries, [point](const auto& entry) {
+                return entry.path == point;
+            }))
+        {
+            continue;
+        }
+
+        info("Discovered storage {PATH} of type {TYPE}", "PATH", mount->point,
+             "TYPE", mount->fsType);
+        auto& config = deriveConfig(discovery->config);
+        config.name += "_" + mount->point;
+        config.path = mount->point;
+        entries.push_back({.metric = &addMetric(context, config),
+                           .path = mount->point,
+                           .discovered = true});
+    }
+
+    for (auto& entry : entries)
+    {
+        if (entry.discovered && !entry.mounted && !entry.metric->isStale())
+        {
+            info("Storage {PATH} was unmounted", "PATH", entry.path);
+            entry.metric->markStale();
+        }
+    }
+}
+
+void StorageCollector::receive()
+{
+    workers.poll([this](const Result& result) {
+        auto& entry = entries[result.index];
+        entry.pending = false;
+        logThrottle().clear("statvfs pending " + entry.path);
+        // The statvfs may have raced with the unmount
+        if (!entry.mounted)
+        {
+            return;
+        }
+        // A missing mount fails on every cycle until it comes back
+        auto key = "statvfs " + entry.path;
+        if (result.error != 0)
+        {
+            if (logThrottle().admit(key))
+            {
+                error("Error from statvfs: {ERROR}, path: {PATH}", "ERROR",
+                      strerror(result.error), "PATH", entry.path);
+            }
+            return;
+        }
+        logThrottle().clear(key);
+        debug("Storage Metric {NAME}: {VALUE}, {TOTAL}", "NAME",
+              entry.metric->name(), "VALUE", result.value, "TOTAL",
+              result.total);
+        entry.metric->update(
+            MValue(result.value, result.total, result.timestamp));
+    });
+}
+
+auto StorageCollector::pending(
+    std::chrono::steady_clock::time_point submitted) const -> bool
+{
+    return std::ranges::any_of(entries, [submitted](const auto& entry) {
+        return entry.pending && entry.submitted == submitted;
+    });
+}
+
+auto StorageCollector::collect(sdbusplus::async::context& ctx)
+    -> sdbusplus::async::task<bool>
+{
+    /*
+     * statvfs can block for a long time on a degraded device or a hung
+     * mount, so it runs on the workers. Their results are awaited on the
+     * eventfd of the pool, which lets the other collections run meanwhile,
+     * and the ones which miss the budget are published on a later cycle.
+     * A mount has one statvfs outstanding at most, and the pool grows while
+     * its workers are busy, so the hung mounts don't hold up the others.
+     */
+    if (mountTable && mountTable->changed())
+    {
+        discover();
+    }
+
+    // Results which came in after the budget of the last cycle
+    receive();
+
+    auto now = std::chrono::steady_clock::now();
+    for (size_t index = 0; index < entries.size(); index++)
+    {
+        auto& entry = entries[index];
+        if (!entry.mounted)
+        {
+            continue;
+        }
+        if (entry.pending)
+        {
+            // A hung mount holds one worker at most, it isn't queued again
+            if (logThrottle().admit("statvfs pending " + entry.path))
+            {
+                warning("Skipping statvfs for {PATH}, the previous one is "
+                        "still outstanding",
+                        "PATH", entry.path);
+            }
+            if (now - entry.submitted > blockingReadTimeout &&
+                !entry.metric->isStale())
+            {
+                warning("Timed out on statvfs for {PATH}", "PATH", entry.path);
+                entry.metric->markStale();
+            }
+            continue;
+        }
+
+        entry.pending = true;
+        entry.submitted = now;
+        workers.submit([index, path = entry.path]() {
+            struct statvfs buffer;
+            if (statvfs(path.c_str(), &buffer) != 0)
+            {
+                return Result{.index = index, .error = errno};
+            }
+            return Result{
+                .index = index,
+                .value = static_cast<double>(buffer.f_bfree) * buffer.f_frsize,
+                .total = static_cast<double>(buffer.f_blocks) * buffer.f_frsize,
+                .timestamp = std::chrono::steady_clock::now()};
+        });
+    }
+
+    auto deadline = now + storageWaitBudget;
+    while (pending(now) && !ctx.stop_requested())
+    {
+        auto remaining = deadline - std::chrono::steady_clock::now();
+        if (remaining <= std::chrono::steady_clock::duration::zero())
+        {
+            break;
+        }
+        try
+        {
+            sdbusplus::async::fdio fdio(
+                ctx, workers.fd(),
+                std::chrono::duration_cast<std::chrono::microseconds>(
+                    remaining));
+            co_await fdio.next();
+        }
+        catch (const std::exception& e)
+        {
+            // Timed out, the remaining results are received next cycle
+            debug("Stopped waiting for statvfs: {ERROR}", "ERROR", e);
+            break;
+        }
+        receive();
+    }
+    co_return true;
+}
+
+CgroupCollector::CgroupCollector(const Context& context) :
+    Collector(context), reader(context.reader)
+{
+    for (auto& config : context.configs)
+    {
+        // The slice of the services, the system slice by default
+        auto root = config.path.empty() ? std::string(cgroupRoot)
+                                        : config.path;
+        auto services =
+            config.services.empty() ? cgroupServices(root) : config.services;
+        for (const auto& service : services)
+        {
+            auto& serviceConfig = deriveConfig(config);
+            serviceConfig.name = config.name + "_" + service;
+            serviceConfig.path = root + "/" + service;
+            for (auto& [key, threshold] : serviceConfig.thresholds)
+            {
+                threshold.target = serviceTarget(threshold.target, service);
+            }
+
+            auto& path = serviceConfig.path;
+            if (config.subType == MetricIntf::SubType::cgroupCPU)
+            {
+                cpuEntries.push_back(
+                    {.metric = &addMetric(context, serviceConfig),
+                     .usage = reader.add(path + "/cpu.stat", cpuStatSize)});
+            }
+            else
+            {
+                memoryEntries.push_back(
+                    {.metric = &addMetric(context, serviceConfig),
+                     .usage =
+                         reader.add(path + "/memory.current", memoryValueSize),
+                     .limit =
+                         reader.add(path + "/memory.max", memoryValueSize)});
+            }
+            if (!std::filesystem::exists(path))
+            {
+                info("Cgroup for {SERVICE} is not available yet", "SERVICE",
+                     service);
+            }
+        }
+    }
+}
+
+auto CgroupCollector::collect() -> bool
+{
+    static const auto cpus = std::max(sysconf(_SC_NPROCESSORS_ONLN), 1L);
+    static const double physicalMemory =
+        static_cast<double>(sysconf(_SC_PHYS_PAGES)) * sysconf(_SC_PAGE_SIZE);
+
+    // The rates are against the time the files were actually read
+    auto now = reader.timestamp();
+
+    for (auto& entry : cpuEntries)
+    {
+        auto content = reader.get(entry.usage);
+        if (!content)
+        {
+            // The cgroup is recreated when the service restarts
+            entry.preTime = {};
+            reader.reopen(entry.usage);
+            continue;
+        }
+        auto usage = parseKeyed(*content, "usage_usec");
+        if (!usage)
+        {
+            continue;
+        }
+        auto preUsage = std::exchange(entry.preUsage, *usage);
+        auto preTime = std::exchange(entry.preTime, now);
+        // The first sample after (re)opening only primes the usage
+        if (preTime == std::chrono::steady_clock::time_point{})
+        {
+            continue;
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                           now - preTime)
+                           .count();
+        if (*usage < preUsage || elapsed <= 0)
+        {
+            continue;
+        }
+        auto value = (100.0 * (*usage - preUsage)) / (elapsed * cpus);
+        debug("Cgroup Metric {NAME}: {VALUE}", "NAME", entry.metric->name(),
+              "VALUE", value);
+        entry.metric->update(MValue(value, 100, now));
+    }
+
+    for (auto& entry : memoryEntries)
+    {
+        auto content = reader.get(entry.usage);
+        if (!content)
+        {
+            reader.reopen(entry.limit);
+            reader.reopen(entry.usage);
+            continue;
+        }
+        auto usage = parseValue(*content);
+        if (!usage)
+        {
+            continue;
+        }
+        double value = *usage;
+        // Services without a memory limit are bounded by the system
+        auto limitContent = reader.get(entry.limit);
+        auto limit = limitContent ? parseValue(*limitContent) : std::nullopt;
+        double total = limit ? static_cast<double>(*limit) : physicalMemory;
+        debug("Cgroup Metric {NAME}: {VALUE}, {TOTAL}", "NAME",
+              entry.metric->name(), "VALUE", value, "TOTAL", total);
+        entry.metric->update(MValue(value, total, now));
+    }
+    return true;
+}
+
+KernelCollector::KernelCollector(const Context& context) :
+    Collector(context), reader(context.reader), fileNr(reader.add(procFileNr)),
+    pidMax(reader.add(procPidMax)), loadavg(reader.add(procLoadavg)),
+    stat(reader.add(procStat, procStatSize))
+{
+    using SubType = MetricIntf::SubType;
+    static const std::unordered_map<SubType, Value> values = {
+        {SubType::kernelFileHandles, fileHandles},
+        {SubType::kernelProcesses, processes},
+        {SubType::kernelLoad1, load1},
+        {SubType::kernelLoad5, load5},
+        {SubType::kernelLoad15, load15},
+        {SubType::kernelContextSwitches, contextSwitches},
+        {SubType::kernelForks, forks}};
+
+    for (auto& config : context.configs)
+    {
+        auto value = values.find(config.subType);
+        if (value == values.end())
+        {
+            error("Invalid kernel metric {SUBTYPE}", "SUBTYPE",
+                  config.subType);
+            continue;
+        }
+        entries.push_back(
+            {.metric = &addMetric(context, config), .value = value->second});
+    }
+}
+
+auto KernelCollector::collect() -> bool
+{
+    auto now = reader.timestamp();
+    std::array<std::optional<MValue>, count> values;
+
+    // allocated, unused and maximum number of file handles
+    if (auto content = reader.get(fileNr))
+    {
+        auto allocated = parseValue(nextField(*content));
+        auto unused = parseValue(nextField(*content));
+        auto maximum = parseValue(nextField(*content));
+        if (allocated && unused && maximum)
+        {
+            values[fileHandles] = MValue(*allocated - *unused, *maximum, now);
+        }
+    }
+
+    // 1, 5 and 15 minutes load, runnable/total tasks and last PID
+    if (auto content = reader.get(loadavg))
+    {
+        for (auto value : {load1, load5, load15})
+        {
+            if (auto load = parseDouble(nextField(*content)))
+            {
+                values[value] = MValue(*load, 100, now);
+            }
+        }
+        // Every task, including threads, takes a PID
+        auto tasks = nextField(*content);
+        auto total = parseValue(tasks.substr(tasks.find('/') + 1));
+        auto pidMaxContent = reader.get(pidMax);
+        auto maximum = pidMaxContent ? parseValue(*pidMaxContent)
+                                     : std::nullopt;
+        if (total && maximum)
+        {
+            values[processes] = MValue(*total, *maximum, now);
+        }
+    }
+
+    // Rates of the counters since boot, over the time between the reads
+    if (const auto* counters = reader.parse(stat, parseProcStat))
+    {
+        if (counters->contextSwitches && counters->forks)
+        {
+            auto switches = *counters->contextSwitches;
+            auto preSwitches = std::exchange(preContextSwitches, switches);
+            auto forked = *counters->forks;
+            auto preForked = std::exchange(preForks, forked);
+            auto previous = std::exchange(preTime, now);
+            auto elapsed =
+                std::chrono::duration<double>(now - previous).count();
+            bool primed = previous != std::chrono::steady_clock::time_point{};
+            if (primed && elapsed > 0 && switches >= preSwitches &&
+                forked >= preForked)
+            {
+                values[contextSwitches] =
+                    MValue((switches - preSwitches) / elapsed, 100, now);
+                values[forks] = MValue((forked - preForked) / elapsed, 100,
+                                       now);
+            }
+        }
+    }
+
+    for (auto& entry : entries)
+    {
+        auto& value = values[entry.value];
+        if (!value)
+        {
+            continue;
+        }
+        debug("Kernel Metric {NAME}: {VALUE}, {TOTAL}", "NAME",
+              entry.metric->name(), "VALUE", value->current, "TOTAL",
+              value->total);
+        entry.metric->update(*value);
+    }
+    return std::ranges::any_of(values, [](auto& v) { return v.has_value(); });
+}
+
+VMStatCollector::VMStatCollector(const Context& context) :
+    Collector(context), reader(context.reader),
+    slot(reader.add(procVmstat, procVmstatSize))
+{
+    using SubType = MetricIntf::SubType;
+    static const std::unordered_map<SubType, Counter> counters = {
+        {SubType::vmstatMajorFaults, majorFaults},
+        {SubType::vmstatSwapIn, swapIns},
+        {SubType::vmstatSwapOut, swapOuts},
+        {SubType::vmstatOomKills, oomKills}};
+
+    for (auto& config : context.configs)
+    {
+        auto counter = counters.find(config.subType);
+        if (counter == counters.end())
+        {
+            error("Invalid vmstat metric {SUBTYPE}", "SUBTYPE",
+                  config.subType);
+            continue;
+        }
+        entries.push_back({.metric = &addMetric(context, config),
+                           .counter = counter->second});
+    }
+}
+
+auto VMStatCollector::collect() -> bool
+{
+    auto content = reader.get(slot);
+    if (!content)
+    {
+        if (logThrottle().admit("vmstat read"))
+        {
+            error("Unable to read {PATH} for VMStat stats", "PATH",
+                  procVmstat);
+        }
+        return false;
+    }
+
+    static constexpr std::array<std::string_view, count> names = {
+        "pgmajfault", "pswpin", "pswpout", "oom_kill"};
+    std::array<std::optional<uint64_t>, count> counters;
+    while (!content->empty())
+    {
+        auto line = content->substr(0, content->find('\n'));
+        content->remove_prefix(std::min(line.size() + 1, content->size()));
+
+        auto name = std::ranges::find(names, nextField(line));
+        if (name != names.end())
+        {
+            counters[name - names.begin()] = parseValue(nextField(line));
+        }
+    }
+
+    // Rates of the counters since boot, over the time between the reads
+    auto now = reader.timestamp();
+    auto previous = std::exchange(preTime, now);
+    auto elapsed = std::chrono::duration<double>(now - previous).count();
+    bool primed = previous != std::chrono::steady_clock::time_point{};
+    std::array<std::optional<double>, count> rates;
+    for (size_t counter = 0; counter < count; counter++)
+    {
+        auto value = counters[counter];
+        auto preValue = std::exchange(preCounters[counter], value);
+        if (primed && elapsed > 0 && value && preValue && *value >= *preValue)
+        {
+            rates[counter] = (*value - *preValue) / elapsed;
+        }
+    }
+
+    for (auto& entry : entries)
+    {
+        auto& rate = rates[entry.counter];
+        if (!rate)
+        {
+            continue;
+        }
+        debug("VMStat Metric {NAME}: {VALUE}", "NAME", entry.metric->name(),
+              "VALUE", *rate);
+        entry.metric->update(MValue(*rate, 100, now));
+    }
+    return std::ranges::any_of(counters,
+                               [](auto& c) { return c.has_value(); });
+}
+
+ProcessCollector::ProcessCollector(const Context& context) :
+    Collector(context), reader(context.reader)
+{
+    for (auto& config : context.configs)
+    {
+        if (config.services.empty())
+        {
+            warning("No services listed for {NAME}", "NAME", config.name);
+        }
+        auto& entries = (config.subType == MetricIntf::SubType::processRSS)
+                            ? rssEntries
+                            : pssEntries;
+        for (const auto& service : config.services)
+        {
+            auto& serviceConfig = deriveConfig(config);
+            serviceConfig.name = config.name + "_" + service;
+            serviceConfig.path = service;
+            for (auto& [key, threshold] : serviceConfig.thresholds)
+            {
+                threshold.target = serviceTarget(threshold.target, service);
+            }
+            entries.push_back({.metric = &addMetric(context, serviceConfig),
+                               .service = service});
+        }
+    }
+}
+
+auto ProcessCollector::collect() -> bool
+{
+    static const auto pageSize = sysconf(_SC_PAGE_SIZE);
+    static const double physicalMemory =
+        static_cast<double>(sysconf(_SC_PHYS_PAGES)) * pageSize;
+
+    auto now = reader.timestamp();
+    auto update = [&](std::vector<Entry>& entries, auto parse) {
+        for (auto& entry : entries)
+        {
+            if (entry.pid == 0)
+            {
+                continue;
+            }
+            // Without content the process exited, wait for the new main PID
+            auto content = reader.get(*entry.slot);
+            if (!content)
+            {
+                if (!entry.metric->isStale())
+                {
+                    entry.metric->markStale();
+                }
+                continue;
+            }
+            auto value = parse(*content);
+            if (!value)
+            {
+                continue;
+            }
+            debug("Process Metric {NAME}: {VALUE}", "NAME",
+                  entry.metric->name(), "VALUE", *value);
+            entry.metric->update(MValue(*value, physicalMemory, now));
+        }
+    };
+
+    update(rssEntries, [](std::string_view content) {
+        // Total and resident pages
+        nextField(content);
+        return parseValue(nextField(content)).transform([](auto pages) {
+            return static_cast<double>(pages) * pageSize;
+        });
+    });
+    update(pssEntries, [](std::string_view content) {
+        return parseKeyed(content, "Pss:").transform([](auto kib) {
+            return static_cast<double>(kib) * 1024;
+        });
+    });
+    return true;
+}
+
+auto ProcessCollector::services() const -> std::vector<std::string>
+{
+    std::vector<std::string> services;
+    for (const auto* entries : {&rssEntries, &pssEntries})
+    {
+        for (const auto& entry : *entries)
+        {
+            if (std::ranges::find(services, entry.service) == services.end())
+            {
+                services.push_back(entry.service);
+            }
+        }
+    }
+    return services;
+}
+
+void ProcessCollector::updatePid(const std::string& service, uint32_t pid)
+{
+    updatePid(rssEntries, "statm", statmSize, service, pid);
+    updatePid(pssEntries, "smaps_rollup", smapsRollupSize, service, pid);
+}
+
+void ProcessCollector::updatePid(std::vector<Entry>& entries,
+                                 const std::string& file, size_t size,
+                                 const std::string& service, uint32_t pid)
+{
+    for (auto& entry : entries)
+    {
+        if (entry.service != service || entry.pid == pid)
+        {
+            continue;
+        }
+        debug("Main PID of {SERVICE} is {PID}", "SERVICE", service, "PID",
+              pid);
+        entry.pid = pid;
+        if (pid != 0)
+        {
+            // An open proc file stays with its process, so a reused PID
+            // isn't measured in its place
+            auto path = std::format("/proc/{}/{}", pid, file);
+            if (entry.slot)
+            {
+                reader.reopen(*entry.slot, path);
+            }
+            else
+            {
+                entry.slot = reader.add(path, size);
+            }
+            if (reader.isOpen(*entry.slot))
+            {
+                continue;
+            }
+            debug("Unable to open {PATH} of {SERVICE}", "PATH", path,
+                  "SERVICE", service);
+        }
+        // The service isn't running, or its process already exited
+        if (!entry.metric->isStale())
+        {
+            entry.metric->markStale();
+        }
+    }
+}
+
+} // namespace phosphor::health::metric::collection
@@ -0,0 +1,493 @@
+#pragma once
+
+#include "health_batch_reader.hpp"
+#include "health_metric.hpp"
+#include "health_mounts.hpp"
+#include "health_worker.hpp"
+
+#include <sdbusplus/async.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace phosphor::health::metric::collection
+{
+namespace ConfigIntf = phosphor::health::metric::config;
+namespace MetricIntf = phosphor::health::metric;
+
+using configs_t = std::vector<ConfigIntf::HealthMetric>;
+using slot_t = reader::BatchReader::slot_t;
+
+/** @brief What a collector is constructed from */
+struct Context
+{
+    /** @brief D-Bus bus connection */
+    sdbusplus::bus_t& bus;
+    /** @brief Health metric configs of the collector */
+    const configs_t& configs;
+    /** @brief BMC inventory paths measured by the metrics */
+    const MetricIntf::paths_t& bmcPaths;
+    /** @brief Batch reader for the files of all collections */
+    reader::BatchReader& reader;
+};
+
+/** @brief Base of the collectors, one per metric type.
+ *
+ *  A collector works out at construction which values it reads for each of
+ *  its metrics, so collecting them doesn't branch on the metric subtypes.
+ */
+template <typename Derived>
+class Collector
+{
+  public:
+    Collector(const Collector&) = delete;
+    Collector& operator=(const Collector&) = delete;
+
+    /** @brief Emit the InterfacesAdded signals for all metrics */
+    void announce()
+    {
+        announced = true;
+        for (auto& metric : metrics)
+        {
+            metric->announce();
+        }
+    }
+
+    /** @brief Update the BMC inventory paths for all metrics */
+    void updateAssociations(const MetricIntf::paths_t& bmcPaths)
+    {
+        for (auto& metric : metrics)
+        {
+            metric->updateAssociations(bmcPaths);
+        }
+    }
+
+    /** @brief Add all metrics to the OpenMetrics exposition */
+    void exportTo(exporter::Exposition& exposition)
+    {
+        this->exposition = &exposition;
+        for (auto& metric : metrics)
+        {
+            metric->exportTo(exposition);
+        }
+    }
+
+    /** @brief Add all metrics to the shared memory segment */
+    void shareTo(shm::Writer& writer)
+    {
+        for (auto& metric : metrics)
+        {
+            metric->shareTo(writer);
+        }
+    }
+
+    /** @brief Capture snapshots when severe thresholds of the metrics
+     *         assert */
+    void snapshotTo(snapshot::Snapshotter& snapshotter)
+    {
+        this->snapshotter = &snapshotter;
+        for (auto& metric : metrics)
+        {
+            metric->snapshotTo(snapshotter);
+        }
+    }
+
+  protected:
+    explicit Collector(const Context& context) :
+        arena(arenaSize(context.configs))
+    {}
+    ~Collector() = default;
+
+    /** @brief Copy a config to be adapted for a service or a mount, which
+     *         is kept for the lifetime of the metrics referring to it */
+    auto deriveConfig(const ConfigIntf::HealthMetric& config)
+        -> ConfigIntf::HealthMetric&
+    {
+        return derivedConfigs.emplace_back(config);
+    }
+
+    /** @brief Create the health metric for the config.
+     *
+     *  A metric created after startup is exported, snapshotted and announced
+     *  like the others, but it isn't in the shared memory segment, which is
+     *  sized for the metrics created before its first commit. The metric
+     *  refers to the config, which must outlive the collector.
+     */
+    auto addMetric(const Context& context,
+                   const ConfigIntf::HealthMetric& config)
+        -> MetricIntf::HealthMetric&
+    {
+        auto& metric =
+            *metrics.emplace_back(std::make_unique<MetricIntf::HealthMetric>(
+                context.bus, Derived::type, config, context.bmcPaths, &arena));
+        if (exposition)
+        {
+            metric.exportTo(*exposition);
+        }
+        if (snapshotter)
+        {
+            metric.snapshotTo(*snapshotter);
+        }
+        if (announced)
+        {
+            metric.announce();
+        }
+        return metric;
+    }
+
+  private:
+    /** @brief Size of the arena for the windows of the metrics of the
+     *         configs, which are sized once, at the window size */
+    static auto arenaSize(const configs_t& configs) -> size_t
+    {
+        size_t size = 0;
+        for (const auto& config : configs)
+        {
+            size += std::max<size_t>(config.services.size(), 1) *
+                    std::max<size_t>(config.windowSize, 1) *
+                    sizeof(MetricIntf::aggregator::Sample);
+        }
+        return std::max(size, minArenaSize);
+    }
+
+    /** @brief Smallest arena, for the metrics created after startup */
+    static constexpr size_t minArenaSize = 1024;
+
+    /** @brief Configs adapted for the services or mounts of a config */
+    std::deque<ConfigIntf::HealthMetric> derivedConfigs;
+    /** @brief Arena for the windows of the metrics.
+     *
+     *  The windows are allocated once, when the metrics are created, so
+     *  nothing is freed until the collector is. Metrics beyond the initial
+     *  size, like the cgroups of all services or the discovered mounts, grow
+     *  it from the heap.
+     */
+    std::pmr::monotonic_buffer_resource arena;
+
+  protected:
+    /** @brief Health metrics of the collector */
+    std::vector<std::unique_ptr<MetricIntf::HealthMetric>> metrics;
+
+  private:
+    /** @brief Exposition of the metrics, once exported */
+    exporter::Exposition* exposition = nullptr;
+    /** @brief Snapshotter of the metrics, once set */
+    snapshot::Snapshotter* snapshotter = nullptr;
+    /** @brief The metrics were announced */
+    bool announced = false;
+};
+
+/** @brief Collector which reads its metrics without waiting */
+template <typename T>
+concept SyncCollector = requires(T& collector) {
+    { collector.collect() } -> std::same_as<bool>;
+};
+
+/** @brief Collector which awaits I/O, e.g. a file descriptor or a D-Bus
+ *         call, while reading its metrics */
+template <typename T>
+concept AsyncCollector = requires(T& collector,
+                                  sdbusplus::async::context& ctx) {
+    { collector.collect(ctx) } -> std::same_as<sdbusplus::async::task<bool>>;
+};
+
+/** @brief Requirements of a collector in the registry */
+template <typename T>
+concept CollectorType =
+    std::derived_from<T, Collector<T>> && std::constructible_from<T, Context> &&
+    (SyncCollector<T> || AsyncCollector<T>) && requires {
+        { T::type } -> std::convertible_to<MetricIntf::Type>;
+    };
+
+/** @brief Collector of the CPU utilization from /proc/stat */
+class CPUCollector : public Collector<CPUCollector>
+{
+  public:
+    static constexpr auto type = MetricIntf::Type::cpu;
+
+    explicit CPUCollector(const Context& context);
+    auto collect() -> bool;
+
+  private:
+    struct Entry
+    {
+        MetricIntf::HealthMetric* metric;
+        /** @brief Mask of the CPU times counted as active */
+        uint32_t active;
+        uint64_t preActiveTime = 0;
+        uint64_t preTotalTime = 0;
+    };
+
+    reader::BatchReader& reader;
+    slot_t slot;
+    std::vector<Entry> entries;
+};
+
+/** @brief Collector of the memory and swap from /proc/meminfo */
+class MemoryCollector : public Collector<MemoryCollector>
+{
+  public:
+    static constexpr auto type = MetricIntf::Type::memory;
+
+    explicit MemoryCollector(const Context& context);
+    auto collect() -> bool;
+
+  private:
+    struct Entry
+    {
+        MetricIntf::HealthMetric* metric;
+        /** @brief Mask of the meminfo fields summed up for the metric */
+        uint32_t fields;
+        /** @brief Meminfo field the metric is relative to */
+        size_t total;
+    };
+
+    reader::BatchReader& reader;
+    slot_t slot;
+    std::vector<Entry> entries;
+};
+
+/** @brief Collector of the free space of filesystems, with statvfs on
+ *         worker threads.
+ *
+ *  The results of the statvfs calls are awaited within the collection, up to
+ *  half of the collection interval, and the ones of a hung filesystem are
+ *  published in a later collection. Besides the configured paths, the
+ *  writable mounts which pass the filters of a Storage_Mounts config get a
+ *  metric each. The mount table is only read again when the kernel signals
+ *  it changed.
+ */
+class StorageCollector : public Collector<StorageCollector>
+{
+  public:
+    static constexpr auto type = MetricIntf::Type::storage;
+
+    explicit StorageCollector(const Context& context);
+    auto collect(sdbusplus::async::context& ctx)
+        -> sdbusplus::async::task<bool>;
+
+  private:
+    /** @brief Result of the statvfs for a storage metric */
+    struct Result
+    {
+        /** @brief Index of the storage metric */
+        size_t index = 0;
+        /** @brief Error number from statvfs */
+        int error = 0;
+        /** @brief Free space in bytes */
+        double value = 0;
+        /** @brief Total space in bytes */
+        double total = 0;
+        /** @brief Monotonic time of the statvfs */
+        std::chrono::steady_clock::time_point timestamp;
+    };
+
+    struct Entry
+    {
+        MetricIntf::HealthMetric* metric;
+        /** @brief Path of the filesystem */
+        std::string path;
+        /** @brief Waiting for the result of the statvfs */
+        bool pending = false;
+        /** @brief Time at which the statvfs was submitted */
+        std::chrono::steady_clock::time_point submitted;
+        /** @brief The metric is for a discovered mount */
+        bool discovered = false;
+        /** @brief The discovered mount is mounted */
+        bool mounted = true;
+    };
+
+    /** @brief Config of the metrics of the discovered mounts */
+    struct Discovery
+    {
+        const ConfigIntf::HealthMetric& config;
+        /** @brief Filter of the mounts of the config */
+        mounts::Filter filter;
+    };
+
+    /** @brief Create the metrics of the new mounts which pass a filter, and
+     *         mark the metrics of the unmounted ones as stale */
+    void discover();
+    /** @brief Update the metrics with the results of the workers */
+    void receive();
+    /** @brief Whether results submitted at the time are still pending */
+    auto pending(std::chrono::steady_clock::time_point submitted) const
+        -> bool;
+
+    /** @brief Context to create the metrics of the discovered mounts */
+    Context context;
+    std::vector<Entry> entries;
+    std::vector<Discovery> discoveries;
+    /** @brief Mount table, if any mounts are discovered */
+    std::optional<mounts::MountTable> mountTable;
+    /** @brief Workers for the statvfs calls, which may block */
+    worker::WorkerPool<Result> workers;
+};
+
+/** @brief Collector of the CPU and memory of systemd services from their
+ *         cgroups */
+class CgroupCollector : public Collector<CgroupCollector>
+{
+  public:
+    static constexpr auto type = MetricIntf::Type::cgroup;
+
+    explicit CgroupCollector(const Context& context);
+    auto collect() -> bool;
+
+  private:
+    struct CPUEntry
+    {
+        MetricIntf::HealthMetric* metric;
+        /** @brief Reader slot of cpu.stat */
+        slot_t usage;
+        /** @brief Previous CPU usage in microseconds */
+        uint64_t preUsage = 0;
+        /** @brief Time of the previous CPU usage, unset until primed */
+        std::chrono::steady_clock::time_point preTime;
+    };
+
+    struct MemoryEntry
+    {
+        MetricIntf::HealthMetric* metric;
+        /** @brief Reader slot of memory.current */
+        slot_t usage;
+        /** @brief Reader slot of memory.max */
+        slot_t limit;
+    };
+
+    reader::BatchReader& reader;
+    std::vector<CPUEntry> cpuEntries;
+    std::vector<MemoryEntry> memoryEntries;
+};
+
+/** @brief Collector of the kernel resources */
+class KernelCollector : public Collector<KernelCollector>
+{
+  public:
+    static constexpr auto type = MetricIntf::Type::kernel;
+
+    explicit KernelCollector(const Context& context);
+    auto collect() -> bool;
+
+  private:
+    /** @brief Values read in a cycle */
+    enum Value
+    {
+        fileHandles,
+        processes,
+        load1,
+        load5,
+        load15,
+        contextSwitches,
+        forks,
+        count
+    };
+
+    struct Entry
+    {
+        MetricIntf::HealthMetric* metric;
+        Value value;
+    };
+
+    reader::BatchReader& reader;
+    slot_t fileNr;
+    slot_t pidMax;
+    slot_t loadavg;
+    slot_t stat;
+    std::vector<Entry> entries;
+    /** @brief Context switches since boot, at the previous cycle */
+    uint64_t preContextSwitches = 0;
+    /** @brief Forks since boot, at the previous cycle */
+    uint64_t preForks = 0;
+    /** @brief Time of the previous counters, unset until primed */
+    std::chrono::steady_clock::time_point preTime;
+};
+
+/** @brief Collector of the paging, swapping and OOM kill rates from
+ *         /proc/vmstat */
+class VMStatCollector : public Collector<VMStatCollector>
+{
+  public:
+    static constexpr auto type = MetricIntf::Type::vmstat;
+
+    explicit VMStatCollector(const Context& context);
+    auto collect() -> bool;
+
+  private:
+    /** @brief Counters read in a cycle, whose rates are the metrics */
+    enum Counter
+    {
+        majorFaults,
+        swapIns,
+        swapOuts,
+        oomKills,
+        count
+    };
+
+    struct Entry
+    {
+        MetricIntf::HealthMetric* metric;
+        Counter counter;
+    };
+
+    reader::BatchReader& reader;
+    slot_t slot;
+    std::vector<Entry> entries;
+    /** @brief Counters since boot, at the previous cycle */
+    std::array<std::optional<uint64_t>, count> preCounters;
+    /** @brief Time of the previous counters, unset until primed */
+    std::chrono::steady_clock::time_point preTime;
+};
+
+/** @brief Collector of the memory of the main process of systemd services */
+class ProcessCollector : public Collector<ProcessCollector>
+{
+  public:
+    static constexpr auto type = MetricIntf::Type::process;
+
+    explicit ProcessCollector(const Context& context);
+    auto collect() -> bool;
+
+    /** @brief Get the systemd services measured by the metrics */
+    auto services() const -> std::vector<std::string>;
+    /** @brief Update the main PID of a service, 0 if it isn't running */
+    void updatePid(const std::string& service, uint32_t pid);
+
+  private:
+    struct Entry
+    {
+        MetricIntf::HealthMetric* metric;
+        /** @brief Systemd service of the process */
+        std::string service;
+        /** @brief Main PID of the service, 0 if it isn't running */
+        uint32_t pid = 0;
+        /** @brief Reader slot of the proc file of the PID */
+        std::optional<slot_t> slot;
+    };
+
+    /** @brief Point the entries of the service at the new PID */
+    void updatePid(std::vector<Entry>& entries, const std::string& file,
+                   size_t size, const std::string& service, uint32_t pid);
+
+    reader::BatchReader& reader;
+    std::vector<Entry> rssEntries;
+    std::vector<Entry> pssEntries;
+};
+
+/** @brief Registry of the collectors, by their metric type */
+using Collectors =
+    std::tuple<CPUCollector, MemoryCollector, StorageCollector,
+               CgroupCollector, KernelCollector, ProcessCollector,
+               VMStatCollector>;
+
+} // namespace phosphor::health::metric::collection
@@ -2,12 +2,17 @@
 
 #include "health_metric_config.hpp"
 
+#include "health_metric_aggregator.hpp"
+
 #include <nlohmann/json.hpp>
 #include <phosphor-logging/lg2.hpp>
 
+#include <array>
 #include <cmath>
 #include <fstream>
 #include <ranges>
+#include <span>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
@@ -21,13 +26,37 @@ namespace config
 
 using json = nlohmann::json;
 
+/** Default threshold config, kept as a compile-time constant. */
+struct DefaultThreshold
+{
+    ThresholdIntf::Type type;
+    ThresholdIntf::Bound bound;
+    double value;
+    bool log;
+    std::string_view target;
+};
+
+/** Default health metric config, kept as a compile-time constant. */
+struct DefaultHealthMetric
+{
+    std::string_view name;
+    std::string_view path;
+    std::span<const DefaultThreshold> thresholds;
+};
+
 // Default health metric config
-extern json defaultHealthMetricConfig;
+extern const std::span<const DefaultHealthMetric> defaultHealthMetricConfig;
 
 // Valid thresholds from config
 static const auto validThresholdTypesWithBound =
-    std::unordered_set<std::string>{"Critical_Lower", "Critical_Upper",
-                                    "Warning_Lower", "Warning_Upper"};
+    std::unordered_set<std::string>{
+        "HardShutdown_Lower",    "HardShutdown_Upper", "SoftShutdown_Lower",
+        "SoftShutdown_Upper",    "PerformanceLoss_Lower",
+        "PerformanceLoss_Upper", "Critical_Lower",     "Critical_Upper",
+        "Warning_Lower",         "Warning_Upper"};
+
+// Predictive threshold on the time to exhaustion of the metric
+static constexpr auto timeToExhaustionKey = "TimeToExhaustion_Lower";
 
 static const auto validThresholdBounds =
     std::unordered_map<std::string, ThresholdIntf::Bound>{
@@ -42,12 +71,25 @@ static const auto validThresholdTypes =
         {"Critical", ThresholdIntf::Type::Critical},
         {"Warning", ThresholdIntf::Type::Warning}};
 
+// Valid window aggregations from config
+static const auto validAggregations =
+    std::unordered_map<std::string, Aggregation>{
+        {"EWMA", Aggregation::ewma},
+        {"Max", Aggregation::max},
+        {"Mean", Aggregation::mean},
+        {"Min", Aggregation::min},
+        {"Percentile", Aggregation::percentile}};
+
 // Valid metrics from config
 static const auto validTypes = std::unordered_map<std::string, Type>{
     {"CPU", Type::cpu},
     {"Memory", Type::memory},
     {"Storage", Type::storage},
-    {"Inode", Type::inode}};
+    {"Inode", Type::inode},
+    {"Cgroup", Type::cgroup},
+    {"Kernel", Type::kernel},
+    {"Process", Type::process},
+    {"VMStat", Type::vmstat}};
 
 // Valid submetrics from config
 static const auto validSubTypes = std::unordered_map<std::string, SubType>{
@@ -59,6 +101,24 @@ static const auto validSubTypes = std::unordered_map<std::string, SubType>{
     {"Memory_Available", SubType::memoryAvailable},
     {"Memory_Shared", SubType::memoryShared},
     {"Memory_Buffered_And_Cached", SubType::memoryBufferedAndCached},
+    {"Memory_Swap_Free", SubType::memorySwapFree},
+    {"Memory_Swap_Total", SubType::memorySwapTotal},
+    {"Cgroup_CPU", SubType::cgroupCPU},
+    {"Cgroup_Memory", SubType::cgroupMemory},
+    {"Kernel_File_Handles", SubType::kernelFileHandles},
+    {"Kernel_Processes", SubType::kernelProcesses},
+    {"Kernel_Load_1", SubType::kernelLoad1},
+    {"Kernel_Load_5", SubType::kernelLoad5},
+    {"Kernel_Load_15", SubType::kernelLoad15},
+    {"Kernel_Context_Switches", SubType::kernelContextSwitches},
+    {"Kernel_Forks", SubType::kernelForks},
+    {"Process_RSS", SubType::processRSS},
+    {"Process_PSS", SubType::processPSS},
+    {"VMStat_Major_Faults", SubType::vmstatMajorFaults},
+    {"VMStat_Swap_In", SubType::vmstatSwapIn},
+    {"VMStat_Swap_Out", SubType::vmstatSwapOut},
+    {"VMStat_OOM_Kills", SubType::vmstatOomKills},
+    {"Storage_Mounts", SubType::storageMounts},
     {"Storage_RW", SubType::NA},
     {"Storage_TMP", SubType::NA}};
 
@@ -68,6 +128,21 @@ void from_json(const json& j, Threshold& self)
     self.value = j.value("Value", 100.0);
     self.log = j.value("Log", false);
     self.target = j.value("Target", Threshold::defaults::target);
+    self.windowSize =
+        j.value("Window_size", Threshold::defaults::windowSize);
+}
+
+/** Get the default number of samples a threshold is evaluated on. */
+auto defaultWindowSize(ThresholdIntf::Type type) -> size_t
+{
+    // The shutdown thresholds react to the latest sample rather than wait for
+    // the window to fill
+    if (type == ThresholdIntf::Type::HardShutdown ||
+        type == ThresholdIntf::Type::SoftShutdown)
+    {
+        return 1;
+    }
+    return Threshold::defaults::windowSize;
 }
 
 /** Deserialize a HealthMetric from JSON. */
@@ -76,8 +151,49 @@ void from_json(const json& j, HealthMetric& self)
     self.windowSize =
         j.value("Window_size", HealthMetric::defaults::windowSize);
     self.hysteresis = j.value("Hysteresis", HealthMetric::defaults::hysteresis);
-    // Path is only valid for storage
+    self.hysteresisAbsolute = j.value(
+        "Hysteresis_absolute", HealthMetric::defaults::hysteresisAbsolute);
+    self.minPublishInterval = std::chrono::seconds(
+        j.value("Min_publish_interval",
+                HealthMetric::defaults::minPublishInterval.count()));
+    self.maxPublishInterval = std::chrono::seconds(
+        j.value("Max_publish_interval",
+                HealthMetric::defaults::maxPublishInterval.count()));
+    if (self.hysteresisAbsolute < 0 || self.minPublishInterval < 0s ||
+        self.maxPublishInterval < 0s)
+    {
+        throw std::invalid_argument("Invalid publish hysteresis or interval");
+    }
+
+    auto aggregation = j.value("Aggregation", std::string("Mean"));
+    if (auto match = validAggregations.find(aggregation);
+        match != validAggregations.end())
+    {
+        self.aggregation = match->second;
+    }
+    else
+    {
+        warning("Invalid Aggregation: {AGGREGATION}", "AGGREGATION",
+                aggregation);
+    }
+    self.percentile = j.value("Percentile", HealthMetric::defaults::percentile);
+    if (!(self.percentile > 0.0 && self.percentile < 100.0))
+    {
+        throw std::invalid_argument("Invalid percentile value");
+    }
+    self.histogramPrecision = j.value(
+        "Histogram_precision", HealthMetric::defaults::histogramPrecision);
+    if (self.histogramPrecision > aggregator::Histogram::maxPrecision)
+    {
+        throw std::invalid_argument("Invalid histogram precision");
+    }
+    // Path is only valid for storage and cgroup
     self.path = j.value("Path", "");
+    // Services is only valid for cgroup and process
+    self.services = j.value("Services", std::vector<std::string>{});
+    // Include and Exclude are only valid for discovered storage
+    self.include = j.value("Include", std::vector<std::string>{});
+    self.exclude = j.value("Exclude", std::vector<std::string>{});
 
     auto thresholds = j.find("Threshold");
     if (thresholds == j.end())
@@ -87,30 +203,111 @@ void from_json(const json& j, HealthMetric& self)
 
     for (auto& [key, value] : thresholds->items())
     {
-        if (!validThresholdTypesWithBound.contains(key))
+        if (key == timeToExhaustionKey)
         {
-            warning("Invalid ThresholdType: {TYPE}", "TYPE", key);
+            self.timeToExhaustion = value.template get<Threshold>();
+            if (!std::isfinite(self.timeToExhaustion->value))
+            {
+                throw std::invalid_argument("Invalid threshold value");
+            }
             continue;
         }
 
-        auto config = value.template get<Threshold>();
-        if (!std::isfinite(config.value))
+        if (!validThresholdTypesWithBound.contains(key))
         {
-            throw std::invalid_argument("Invalid threshold value");
+            warning("Invalid ThresholdType: {TYPE}", "TYPE", key);
+            continue;
         }
 
         static constexpr auto keyDelimiter = "_";
         std::string typeStr = key.substr(0, key.find_first_of(keyDelimiter));
         std::string boundStr =
             key.substr(key.find_last_of(keyDelimiter) + 1, key.length());
+        auto type = validThresholdTypes.at(typeStr);
+
+        auto config = value.template get<Threshold>();
+        if (!std::isfinite(config.value))
+        {
+            throw std::invalid_argument("Invalid threshold value");
+        }
+        if (!value.contains("Window_size"))
+        {
+            config.windowSize = defaultWindowSize(type);
+        }
 
         self.thresholds.emplace(
-            std::make_tuple(validThresholdTypes.at(typeStr),
-                            validThresholdBounds.at(boundStr)),
-            config);
+            std::make_tuple(type, validThresholdBounds.at(boundStr)), config);
     }
 }
 
+/** Get the config key for a threshold type and bound. */
+auto thresholdKey(ThresholdIntf::Type type, ThresholdIntf::Bound bound)
+    -> std::string
+{
+    auto typeStr = std::ranges::find_if(validThresholdTypes, [=](auto& p) {
+        return p.second == type;
+    });
+    auto boundStr = std::ranges::find_if(validThresholdBounds, [=](auto& p) {
+        return p.second == bound;
+    });
+    return typeStr->first + "_" + boundStr->first;
+}
+
+/** Serialize a Threshold to JSON. */
+void to_json(json& j, const Threshold& self)
+{
+    j = json{{"Value", self.value},
+             {"Log", self.log},
+             {"Target", self.target},
+             {"Window_size", self.windowSize}};
+}
+
+/** Serialize a HealthMetric to JSON. */
+void to_json(json& j, const HealthMetric& self)
+{
+    j = json{{"Window_size", self.windowSize},
+             {"Hysteresis", self.hysteresis},
+             {"Hysteresis_absolute", self.hysteresisAbsolute},
+             {"Min_publish_interval", self.minPublishInterval.count()},
+             {"Max_publish_interval", self.maxPublishInterval.count()},
+             {"Aggregation", to_string(self.aggregation)},
+             {"Percentile", self.percentile},
+             {"Histogram_precision", self.histogramPrecision},
+             {"Path", self.path},
+             {"Services", self.services},
+             {"Include", self.include},
+             {"Exclude", self.exclude}};
+
+    auto& thresholds = j["Threshold"] = json::object();
+    for (auto& [key, threshold] : self.thresholds)
+    {
+        thresholds[thresholdKey(get<ThresholdIntf::Type>(key),
+                                get<ThresholdIntf::Bound>(key))] = threshold;
+    }
+    if (self.timeToExhaustion)
+    {
+        thresholds[timeToExhaustionKey] = *self.timeToExhaustion;
+    }
+}
+
+/** Convert a compile-time default to a HealthMetric config. */
+auto toHealthMetric(const DefaultHealthMetric& metric) -> HealthMetric
+{
+    HealthMetric config;
+    config.name = metric.name;
+    config.path = metric.path;
+    for (auto& threshold : metric.thresholds)
+    {
+        config.thresholds.emplace(
+            std::make_tuple(threshold.type, threshold.bound),
+            Threshold{.value = threshold.value,
+                      .log = threshold.log,
+                      .target = std::string(threshold.target),
+                      .windowSize = defaultWindowSize(threshold.type)});
+    }
+    return config;
+}
+
 json parseConfigFile(std::string configFile)
 {
     std::ifstream jsonFile(configFile);
@@ -140,18 +337,19 @@ void printConfig(HealthMetric::map_t& configs)
         for (auto& config : configList)
         {
             debug(
-                "TYPE={TYPE}, NAME={NAME} SUBTYPE={SUBTYPE} PATH={PATH}, WSIZE={WSIZE}, HYSTERESIS={HYSTERESIS}",
+                "TYPE={TYPE}, NAME={NAME} SUBTYPE={SUBTYPE} PATH={PATH}, WSIZE={WSIZE}, HYSTERESIS={HYSTERESIS}, AGGREGATION={AGGREGATION}",
                 "TYPE", type, "NAME", config.name, "SUBTYPE", config.subType,
                 "PATH", config.path, "WSIZE", config.windowSize, "HYSTERESIS",
-                config.hysteresis);
+                config.hysteresis, "AGGREGATION", config.aggregation);
 
             for (auto& [key, threshold] : config.thresholds)
             {
                 debug(
-                    "THRESHOLD TYPE={TYPE} THRESHOLD BOUND={BOUND} VALUE={VALUE} LOG={LOG} TARGET={TARGET}",
+                    "THRESHOLD TYPE={TYPE} THRESHOLD BOUND={BOUND} VALUE={VALUE} LOG={LOG} TARGET={TARGET} WSIZE={WSIZE}",
                     "TYPE", get<ThresholdIntf::Type>(key), "BOUND",
                     get<ThresholdIntf::Bound>(key), "VALUE", threshold.value,
-                    "LOG", threshold.log, "TARGET", threshold.target);
+                    "LOG", threshold.log, "TARGET", threshold.target, "WSIZE",
+                    threshold.windowSize);
             }
         }
     }
@@ -159,16 +357,38 @@ void printConfig(HealthMetric::map_t& configs)
 
 auto getHealthMetricConfigs() -> HealthMetric::map_t
 {
-    json mergedConfig(defaultHealthMetricConfig);
+    std::map<std::string, HealthMetric, std::less<>> mergedConfig;
+    for (auto& metric : defaultHealthMetricConfig)
+    {
+        mergedConfig.emplace(metric.name, toHealthMetric(metric));
+    }
 
+    // Only go through JSON for the metrics the platform overrides.
     if (auto platformConfig = parseConfigFile(HEALTH_CONFIG_FILE);
         !platformConfig.empty())
     {
-        mergedConfig.merge_patch(platformConfig);
+        for (auto& [name, metric] : platformConfig.items())
+        {
+            auto config = mergedConfig.find(name);
+            if (metric.is_null())
+            {
+                if (config != mergedConfig.end())
+                {
+                    mergedConfig.erase(config);
+                }
+                continue;
+            }
+
+            json merged = (config != mergedConfig.end()) ? json(config->second)
+                                                         : json::object();
+            merged.merge_patch(metric);
+            mergedConfig.insert_or_assign(name,
+                                          merged.template get<HealthMetric>());
+        }
     }
 
     HealthMetric::map_t configs = {};
-    for (auto& [name, metric] : mergedConfig.items())
+    for (auto& [name, config] : mergedConfig)
     {
         static constexpr auto nameDelimiter = "_";
         std::string typeStr = name.substr(0, name.find_first_of(nameDelimiter));
@@ -180,7 +400,6 @@ auto getHealthMetricConfigs() -> HealthMetric::map_t
             continue;
         }
 
-        auto config = metric.template get<HealthMetric>();
         config.name = name;
 
         auto subType = validSubTypes.find(name);
@@ -193,70 +412,68 @@ auto getHealthMetricConfigs() -> HealthMetric::map_t
     return configs;
 }
 
-json defaultHealthMetricConfig = R"({
-    "CPU": {
-        "Threshold": {
-            "Critical_Upper": {
-                "Value": 90.0,
-                "Log": true,
-                "Target": ""
-            },
-            "Warning_Upper": {
-                "Value": 80.0,
-                "Log": false,
-                "Target": ""
-            }
-        }
-    },
-    "CPU_User": {
-    },
-    "CPU_Kernel": {
-    },
-    "Memory": {
-    },
-    "Memory_Available": {
-        "Threshold": {
-            "Critical_Lower": {
-                "Value": 15.0,
-                "Log": true,
-                "Target": ""
-            }
-        }
-    },
-    "Memory_Free": {
-    },
-    "Memory_Shared": {
-        "Threshold": {
-            "Critical_Upper": {
-                "Value": 85.0,
-                "Log": true,
-                "Target": ""
-            }
-        }
-    },
-    "Memory_Buffered_And_Cached": {
-    },
-    "Storage_RW": {
-        "Path": "/run/initramfs/rw",
-        "Threshold": {
-            "Critical_Lower": {
-                "Value": 15.0,
-                "Log": true,
-                "Target": ""
-            }
-        }
-    },
-    "Storage_TMP": {
-        "Path": "/tmp",
-        "Threshold": {
-            "Critical_Lower": {
-                "Value": 15.0,
-                "Log": true,
-                "Target": ""
-            }
-        }
-    }
-})"_json;
+namespace
+{
+
+using ThresholdType = ThresholdIntf::Type;
+using ThresholdBound = ThresholdIntf::Bound;
+
+constexpr auto cpuThresholds = std::to_array<DefaultThreshold>({
+    {ThresholdType::Critical, ThresholdBound::Upper, 90.0, true, ""},
+    {ThresholdType::Warning, ThresholdBound::Upper, 80.0, false, ""},
+});
+
+constexpr auto memoryAvailableThresholds = std::to_array<DefaultThreshold>({
+    {ThresholdType::Critical, ThresholdBound::Lower, 15.0, true, ""},
+});
+
+constexpr auto memorySharedThresholds = std::to_array<DefaultThreshold>({
+    {ThresholdType::Critical, ThresholdBound::Upper, 85.0, true, ""},
+});
+
+constexpr auto storageThresholds = std::to_array<DefaultThreshold>({
+    {ThresholdType::Critical, ThresholdBound::Lower, 15.0, true, ""},
+});
+
+constexpr auto kernelFileHandlesThresholds = std::to_array<DefaultThreshold>({
+    {ThresholdType::Critical, ThresholdBound::Upper, 90.0, true, ""},
+    {ThresholdType::Warning, ThresholdBound::Upper, 80.0, false, ""},
+});
+
+constexpr auto kernelProcessesThresholds = std::to_array<DefaultThreshold>({
+    {ThresholdType::Critical, ThresholdBound::Upper, 90.0, true, ""},
+});
+
+constexpr auto defaultHealthMetrics = std::to_array<DefaultHealthMetric>({
+    {"CPU", "", cpuThresholds},
+    {"CPU_User", "", {}},
+    {"CPU_Kernel", "", {}},
+    {"Memory", "", {}},
+    {"Memory_Available", "", memoryAvailableThresholds},
+    {"Memory_Free", "", {}},
+    {"Memory_Shared", "", memorySharedThresholds},
+    {"Memory_Buffered_And_Cached", "", {}},
+    {"Storage_RW", "/run/initramfs/rw", storageThresholds},
+    {"Storage_TMP", "/tmp", storageThresholds},
+    {"Kernel_File_Handles", "", kernelFileHandlesThresholds},
+    {"Kernel_Processes", "", kernelProcessesThresholds},
+    // The thresholds of the loads and rates are absolute, so they have no
+    // defaults, a platform opts in to them with its own config
+    {"Kernel_Load_1", "", {}},
+    {"Kernel_Load_5", "", {}},
+    {"Kernel_Load_15", "", {}},
+    {"Kernel_Context_Switches", "", {}},
+    {"Kernel_Forks", "", {}},
+    {"VMStat_Major_Faults", "", {}},
+    {"VMStat_Swap_In", "", {}},
+    {"VMStat_Swap_Out", "", {}},
+    {"VMStat_OOM_Kills", "", {}},
+});
+
+} // namespace
+
+const std::span<const DefaultHealthMetric> defaultHealthMetricConfig =
+    defaultHealthMetrics;
 
 } // namespace config
 
@@ -286,4 +503,10 @@ auto to_string(SubType t) -> std::string
     return details::reverse_map_search(config::validSubTypes, t);
 }
 
+// to_string specialization for Aggregation.
+auto to_string(Aggregation t) -> std::string
+{
+    return details::reverse_map_search(config::validAggregations, t);
+}
+
 } // namespace phosphor::health::metric
@@ -6,6 +6,7 @@
 #include <chrono>
 #include <limits>
 #include <map>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -21,6 +22,10 @@ enum class Type
     memory,
     storage,
     inode,
+    cgroup,
+    kernel,
+    process,
+    vmstat,
     unknown
 };
 
@@ -36,12 +41,48 @@ enum class SubType
     memoryFree,
     memoryShared,
     memoryTotal,
+    memorySwapFree,
+    memorySwapTotal,
+    // Cgroup subtypes
+    cgroupCPU,
+    cgroupMemory,
+    // Kernel resource subtypes
+    kernelFileHandles,
+    kernelProcesses,
+    kernelLoad1,
+    kernelLoad5,
+    kernelLoad15,
+    kernelContextSwitches,
+    kernelForks,
+    // Process subtypes
+    processRSS,
+    processPSS,
+    // Storage subtypes
+    storageMounts,
+    // Virtual memory subtypes
+    vmstatMajorFaults,
+    vmstatSwapIn,
+    vmstatSwapOut,
+    vmstatOomKills,
+    // Subtypes derived from other metrics
+    timeToExhaustion,
     // Types for which subtype is not applicable
     NA
 };
 
+enum class Aggregation
+{
+    ewma,
+    max,
+    mean,
+    min,
+    // Over tumbling windows, not sliding ones
+    percentile
+};
+
 auto to_string(Type) -> std::string;
 auto to_string(SubType) -> std::string;
+auto to_string(Aggregation) -> std::string;
 
 namespace config
 {
@@ -53,6 +94,9 @@ struct Threshold
     double value = defaults::value;
     bool log = false;
     std::string target = defaults::target;
+    /** @brief The number of latest samples the threshold is evaluated on, 0
+     *         for the window of the metric */
+    size_t windowSize = defaults::windowSize;
 
     using map_t =
         std::map<std::tuple<ThresholdIntf::Type, ThresholdIntf::Bound>,
@@ -62,6 +106,7 @@ struct Threshold
     {
         static constexpr auto value = std::numeric_limits<double>::quiet_NaN();
         static constexpr auto target = "";
+        static constexpr size_t windowSize = 0;
     };
 };
 
@@ -75,10 +120,35 @@ struct HealthMetric
     size_t windowSize = defaults::windowSize;
     /** @brief The hysteresis for the metric */
     double hysteresis = defaults::hysteresis;
+    /** @brief The absolute hysteresis for the metric, in its unit */
+    double hysteresisAbsolute = defaults::hysteresisAbsolute;
+    /** @brief The minimum time between two value signals, 0 for none */
+    std::chrono::seconds minPublishInterval = defaults::minPublishInterval;
+    /** @brief The time after which a changed value is signaled regardless of
+     *         the hysteresis, 0 for never */
+    std::chrono::seconds maxPublishInterval = defaults::maxPublishInterval;
+    /** @brief The statistic of the window compared against thresholds */
+    Aggregation aggregation = defaults::aggregation;
+    /** @brief The percentile for the percentile aggregation */
+    double percentile = defaults::percentile;
+    /** @brief The precision of the histogram of the samples, in bits, 0 for
+     *         no histogram */
+    size_t histogramPrecision = defaults::histogramPrecision;
     /** @brief The threshold configs for the metric. */
     Threshold::map_t thresholds{};
+    /** @brief The threshold config for the time to exhaustion, in seconds */
+    std::optional<Threshold> timeToExhaustion{};
     /** @brief The path for filesystem metric */
     std::string path = defaults::path;
+    /** @brief The systemd services for cgroup metric, empty for all, or for
+     *         process metric */
+    std::vector<std::string> services{};
+    /** @brief The patterns of the mounts monitored by discovered storage
+     *         metrics, empty for all */
+    std::vector<std::string> include{};
+    /** @brief The patterns of the mounts not monitored by discovered storage
+     *         metrics */
+    std::vector<std::string> exclude{};
 
     using map_t = std::map<Type, std::vector<HealthMetric>>;
 
@@ -87,11 +157,21 @@ struct HealthMetric
         static constexpr auto windowSize = 120;
         static constexpr auto path = "";
         static constexpr auto hysteresis = 1.0;
+        static constexpr auto hysteresisAbsolute = 0.0;
+        static constexpr auto minPublishInterval = 0s;
+        static constexpr auto maxPublishInterval = 0s;
+        static constexpr auto aggregation = Aggregation::mean;
+        static constexpr auto percentile = 95.0;
+        static constexpr size_t histogramPrecision = 0;
     };
 };
 
 /** @brief Get the health metric configs. */
 auto getHealthMetricConfigs() -> HealthMetric::map_t;
 
+/** @brief Get the config key for a threshold, e.g. "Critical_Upper". */
+auto thresholdKey(ThresholdIntf::Type type, ThresholdIntf::Bound bound)
+    -> std::string;
+
 } // namespace config
 } // namespace phosphor::health::metric
@@ -0,0 +1,93 @@
+#include "health_metric_histogram.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+PHOSPHOR_LOG2_USING;
+
+namespace phosphor::health::metric
+{
+
+namespace
+{
+
+auto p50(const aggregator::Histogram& histogram) -> double
+{
+    return histogram.percentile(50);
+}
+
+auto p90(const aggregator::Histogram& histogram) -> double
+{
+    return histogram.percentile(90);
+}
+
+auto p99(const aggregator::Histogram& histogram) -> double
+{
+    return histogram.percentile(99);
+}
+
+auto maximum(const aggregator::Histogram& histogram) -> double
+{
+    return histogram.max();
+}
+
+auto count(const aggregator::Histogram& histogram) -> uint64_t
+{
+    return histogram.count();
+}
+
+} // namespace
+
+const sdbusplus::vtable_t HistogramIntf::vtable[] = {
+    sdbusplus::vtable::start(),
+    sdbusplus::vtable::property("P50", "d", getProperty<p50>),
+    sdbusplus::vtable::property("P90", "d", getProperty<p90>),
+    sdbusplus::vtable::property("P99", "d", getProperty<p99>),
+    sdbusplus::vtable::property("Max", "d", getProperty<maximum>),
+    sdbusplus::vtable::property("Count", "t", getProperty<count>),
+    sdbusplus::vtable::method("Reset", "", "", reset),
+    sdbusplus::vtable::end()};
+
+HistogramIntf::HistogramIntf(sdbusplus::bus_t& bus, const std::string& path,
+                             size_t precision) :
+    histogram(precision),
+    serverInterface(bus, path.c_str(), interface, vtable, this)
+{}
+
+template <auto Property>
+int HistogramIntf::getProperty(
+    [[maybe_unused]] sd_bus* bus, [[maybe_unused]] const char* path,
+    [[maybe_unused]] const char* intf, [[maybe_unused]] const char* property,
+    sd_bus_message* reply, void* context, sd_bus_error* error)
+{
+    auto* self = static_cast<HistogramIntf*>(context);
+    try
+    {
+        sdbusplus::message_t(reply).append(Property(self->histogram));
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        return sd_bus_error_set(error, e.name(), e.description());
+    }
+    return 1;
+}
+
+int HistogramIntf::reset(sd_bus_message* msg, void* context,
+                         sd_bus_error* error)
+{
+    auto* self = static_cast<HistogramIntf*>(context);
+    try
+    {
+        info("Reset the histogram of {PATH}", "PATH",
+             sd_bus_message_get_path(msg));
+        self->histogram.reset();
+        auto reply = sdbusplus::message_t(msg).new_method_return();
+        reply.method_return();
+    }
+    catch (const sdbusplus::exception_t& e)
+    {
+        return sd_bus_error_set(error, e.name(), e.description());
+    }
+    return 1;
+}
+
+} // namespace phosphor::health::metric
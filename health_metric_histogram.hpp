@@ -0,0 +1,53 @@
+#pragma once
+
+#include "health_metric_aggregator.hpp"
+
+#include <sdbusplus/bus.hpp>
+#include <sdbusplus/server/interface.hpp>
+#include <sdbusplus/vtable.hpp>
+
+#include <string>
+
+namespace phosphor::health::metric
+{
+
+/** @brief D-Bus interface for the histogram of the samples of a metric.
+ *
+ *  There is no phosphor-dbus-interfaces definition for it, so its vtable is
+ *  written here. The percentiles are computed when they are read, so
+ *  recording a sample doesn't send any signal.
+ */
+class HistogramIntf
+{
+  public:
+    static constexpr auto interface = "xyz.openbmc_project.HealthMon.Histogram";
+
+    HistogramIntf(sdbusplus::bus_t& bus, const std::string& path,
+                  size_t precision);
+    HistogramIntf(const HistogramIntf&) = delete;
+    HistogramIntf& operator=(const HistogramIntf&) = delete;
+
+    /** @brief Record a sample of the metric */
+    void record(double value)
+    {
+        histogram.record(value);
+    }
+
+  private:
+    /** @brief Get a property of the histogram */
+    template <auto Property>
+    static int getProperty(sd_bus* bus, const char* path, const char* intf,
+                           const char* property, sd_bus_message* reply,
+                           void* context, sd_bus_error* error);
+    /** @brief Handle the Reset method */
+    static int reset(sd_bus_message* msg, void* context, sd_bus_error* error);
+
+    static const sdbusplus::vtable_t vtable[];
+
+    /** @brief Histogram of the samples since the last reset */
+    aggregator::Histogram histogram;
+    /** @brief Registration of the interface on the bus */
+    sdbusplus::server::interface_t serverInterface;
+};
+
+} // namespace phosphor::health::metric
@@ -2,11 +2,17 @@
 
 #include "health_monitor.hpp"
 
+#include "health_log_throttle.hpp"
+#include "health_trace.hpp"
+
 #include <phosphor-logging/lg2.hpp>
 #include <sdbusplus/async.hpp>
+#include <sdbusplus/bus/match.hpp>
 #include <xyz/openbmc_project/Inventory/Item/Bmc/common.hpp>
 #include <xyz/openbmc_project/Inventory/Item/common.hpp>
 
+#include <algorithm>
+
 PHOSPHOR_LOG2_USING;
 
 namespace phosphor::health::monitor
@@ -14,40 +20,320 @@ namespace phosphor::health::monitor
 
 using namespace phosphor::health::utils;
 
+static constexpr auto bmcIntf =
+    sdbusplus::common::xyz::openbmc_project::inventory::item::Bmc::interface;
+static constexpr auto invPath = sdbusplus::common::xyz::openbmc_project::
+    inventory::Item::namespace_path;
+
+static constexpr auto systemdBusName = "org.freedesktop.systemd1";
+static constexpr auto systemdPath = "/org/freedesktop/systemd1";
+static constexpr auto systemdManagerIntf = "org.freedesktop.systemd1.Manager";
+static constexpr auto systemdServiceIntf = "org.freedesktop.systemd1.Service";
+static constexpr auto systemdUnitPath = "/org/freedesktop/systemd1/unit";
+
+/** @brief Backoff of the retries of the object mapper lookup */
+static constexpr auto mapperRetryMin = std::chrono::seconds(1);
+static constexpr auto mapperRetryMax = std::chrono::seconds(60);
+
+namespace rules = sdbusplus::bus::match::rules;
+
+HealthMonitor::HealthMonitor(sdbusplus::async::context& ctx) :
+    ctx(ctx), configs(ConfigIntf::getHealthMetricConfigs()),
+    bmcAddedMatch(ctx, rules::interfacesAdded() +
+                           rules::argNpath(0, std::string(invPath) + "/")),
+    bmcRemovedMatch(ctx, rules::interfacesRemoved() +
+                             rules::argNpath(0, std::string(invPath) + "/"))
+{
+    ctx.spawn(startup());
+}
+
 auto HealthMonitor::startup() -> sdbusplus::async::task<>
 {
     info("Creating Health Monitor with config size {SIZE}", "SIZE",
          configs.size());
 
-    static constexpr auto bmcIntf = sdbusplus::common::xyz::openbmc_project::
-        inventory::item::Bmc::interface;
-    static constexpr auto invPath = sdbusplus::common::xyz::openbmc_project::
-        inventory::Item::namespace_path;
-    auto bmcPaths = co_await findPaths(ctx, bmcIntf, invPath);
-
+    /*
+     * Don't wait for the object mapper before creating the metrics, it may
+     * take a while to come up on boot. The associations are filled in once
+     * the BMC inventory paths are known.
+     */
     for (auto& [type, collectionConfig] : configs)
     {
         info("Creating Health Metric Collection for {TYPE}", "TYPE", type);
         collections[type] =
             std::make_unique<CollectionIntf::HealthMetricCollection>(
-                ctx.get_bus(), type, collectionConfig, bmcPaths);
+                ctx.get_bus(), type, collectionConfig, bmcPaths, reader);
     }
 
+    /*
+     * The metric objects are created with their InterfacesAdded signals
+     * deferred and with their properties set silently. Announce them all in
+     * one pass, without yielding to the event loop, so they go out as a
+     * single burst rather than interleaved with the creation of the others.
+     */
+    for (auto& [type, collection] : collections)
+    {
+        collection->announce();
+    }
+
+    if (!std::string_view(OPENMETRICS_SOCKET).empty())
+    {
+        exporter = std::make_unique<phosphor::health::exporter::Exporter>(
+            ctx, OPENMETRICS_SOCKET);
+        for (auto& [type, collection] : collections)
+        {
+            collection->exportTo(exporter->exposition());
+        }
+        phosphor::health::throttle::logThrottle().exportTo(
+            exporter->exposition());
+    }
+
+    if (!std::string_view(SHM_SEGMENT).empty())
+    {
+        sharedMemory =
+            std::make_unique<phosphor::health::shm::Writer>(SHM_SEGMENT);
+        for (auto& [type, collection] : collections)
+        {
+            collection->shareTo(*sharedMemory);
+        }
+        sharedMemory->commit();
+    }
+
+    if (!std::string_view(SNAPSHOT_DIR).empty())
+    {
+        snapshots = std::make_unique<phosphor::health::snapshot::Snapshotter>(
+            SNAPSHOT_DIR, std::chrono::seconds(SNAPSHOT_COOLDOWN),
+            SNAPSHOT_FILES, SNAPSHOT_SIZE);
+        for (auto& [type, collection] : collections)
+        {
+            collection->snapshotTo(*snapshots);
+        }
+    }
+
+    if (collections.contains(MetricIntf::Type::process))
+    {
+        ctx.spawn(watchServices());
+    }
+    ctx.spawn(watchBmcAdded());
+    ctx.spawn(watchBmcRemoved());
+    ctx.spawn(findBmcPaths());
+
     co_await run();
 }
 
+auto HealthMonitor::findBmcPaths() -> sdbusplus::async::task<>
+{
+    /*
+     * The object mapper may not be up yet on boot, and the inventory
+     * matches only catch the changes made after startup, so the lookup is
+     * retried with a backoff until the mapper answers.
+     */
+    constexpr auto throttleKey = "GetSubTreePaths";
+    auto backoff = mapperRetryMin;
+    while (!ctx.stop_requested())
+    {
+        try
+        {
+            auto paths = co_await findPaths(ctx, bmcIntf, invPath);
+            phosphor::health::throttle::logThrottle().clear(throttleKey);
+            for (auto& path : paths)
+            {
+                if (std::ranges::find(bmcPaths, path) == bmcPaths.end())
+                {
+                    bmcPaths.emplace_back(std::move(path));
+                }
+            }
+            updateAssociations();
+            co_return;
+        }
+        catch (std::exception& e)
+        {
+            if (phosphor::health::throttle::logThrottle().admit(throttleKey))
+            {
+                error("Failed to get the BMC inventory paths from the object "
+                      "mapper, retrying: {ERROR}",
+                      "ERROR", e);
+            }
+        }
+        co_await sdbusplus::async::sleep_for(ctx, backoff);
+        backoff = std::min(backoff * 2, mapperRetryMax);
+    }
+}
+
+auto HealthMonitor::watchBmcAdded() -> sdbusplus::async::task<>
+{
+    using value_t = std::variant<std::string>;
+    using interfaces_t = std::map<std::string, std::map<std::string, value_t>>;
+
+    while (!ctx.stop_requested())
+    {
+        auto [path, interfaces] =
+            co_await bmcAddedMatch
+                .next<sdbusplus::message::object_path, interfaces_t>();
+        if (!interfaces.contains(bmcIntf) ||
+            std::ranges::find(bmcPaths, path.str) != bmcPaths.end())
+        {
+            continue;
+        }
+        info("BMC inventory {PATH} added", "PATH", path.str);
+        bmcPaths.emplace_back(path.str);
+        updateAssociations();
+    }
+}
+
+auto HealthMonitor::watchBmcRemoved() -> sdbusplus::async::task<>
+{
+    while (!ctx.stop_requested())
+    {
+        auto [path, interfaces] =
+            co_await bmcRemovedMatch.next<sdbusplus::message::object_path,
+                                          std::vector<std::string>>();
+        if (std::ranges::find(interfaces, bmcIntf) == interfaces.end() ||
+            std::erase(bmcPaths, path.str) == 0)
+        {
+            continue;
+        }
+        info("BMC inventory {PATH} removed", "PATH", path.str);
+        updateAssociations();
+    }
+}
+
+auto HealthMonitor::watchServices() -> sdbusplus::async::task<>
+{
+    /*
+     * Resolve the main PIDs once and then only when the services change, as
+     * scanning /proc on each collection is too expensive. Match before
+     * querying the PIDs, so a restart in between isn't missed.
+     */
+    sdbusplus::async::match serviceMatch(
+        ctx, rules::propertiesChangedNamespace(systemdUnitPath,
+                                               systemdServiceIntf));
+    try
+    {
+        auto manager = sdbusplus::async::proxy()
+                           .service(systemdBusName)
+                           .path(systemdPath)
+                           .interface(systemdManagerIntf);
+        // systemd only emits the unit signals while a client is subscribed
+        co_await manager.call<>(ctx, "Subscribe");
+        for (auto& service : collections[MetricIntf::Type::process]->services())
+        {
+            auto unit = co_await manager.call<sdbusplus::message::object_path>(
+                ctx, "LoadUnit", service);
+            units.emplace(unit.str, service);
+        }
+    }
+    catch (std::exception& e)
+    {
+        error("Failed to subscribe to the systemd services: {ERROR}", "ERROR",
+              e);
+        co_return;
+    }
+
+    for (auto& [unit, service] : units)
+    {
+        co_await queryMainPid(unit);
+    }
+
+    while (!ctx.stop_requested())
+    {
+        auto msg = co_await serviceMatch.next();
+        std::string unit = msg.get_path();
+        if (units.contains(unit))
+        {
+            co_await queryMainPid(unit);
+        }
+    }
+}
+
+auto HealthMonitor::queryMainPid(const std::string& unit)
+    -> sdbusplus::async::task<>
+{
+    auto& service = units.at(unit);
+    try
+    {
+        auto pid = co_await sdbusplus::async::proxy()
+                       .service(systemdBusName)
+                       .path(unit)
+                       .interface(systemdServiceIntf)
+                       .get_property<uint32_t>(ctx, "MainPID");
+        collections[MetricIntf::Type::process]->updatePid(service, pid);
+    }
+    catch (std::exception& e)
+    {
+        error("Failed to get the main PID of {SERVICE}: {ERROR}", "SERVICE",
+              service, "ERROR", e);
+    }
+}
+
+void HealthMonitor::updateAssociations()
+{
+    for (auto& [type, collection] : collections)
+    {
+        collection->updateAssociations(bmcPaths);
+    }
+}
+
 auto HealthMonitor::run() -> sdbusplus::async::task<>
 {
+    constexpr auto interval = std::chrono::seconds(MONITOR_COLLECTION_INTERVAL);
+
     info("Running Health Monitor");
+    /*
+     * Collect on absolute deadlines, so the period doesn't drift by the time
+     * taken by the collection. When a collection overruns, the missed ticks
+     * are skipped and counted rather than run back to back.
+     */
+    auto deadline = std::chrono::steady_clock::now();
     while (!ctx.stop_requested())
     {
-        for (auto& [type, collection] : collections)
+        HEALTH_TRACE(cycle_start);
+        co_await collect();
+
+        deadline += interval;
+        auto now = std::chrono::steady_clock::now();
+        int64_t missed = 0;
+        if (now >= deadline)
         {
-            debug("Reading Health Metric Collection for {TYPE}", "TYPE", type);
-            collection->read();
+            missed = (now - deadline) / interval + 1;
+            overruns += missed;
+            deadline += missed * interval;
+            warning("Health Monitor collection overran, skipped {MISSED} "
+                    "ticks, {TOTAL} in total",
+                    "MISSED", missed, "TOTAL", overruns);
         }
+        HEALTH_TRACE(cycle_end, missed);
         co_await sdbusplus::async::sleep_for(
-            ctx, std::chrono::seconds(MONITOR_COLLECTION_INTERVAL));
+            ctx, std::chrono::duration_cast<std::chrono::microseconds>(
+                     deadline - now));
+    }
+}
+
+auto HealthMonitor::collect() -> sdbusplus::async::task<>
+{
+    // Read the files of all the collections in one batch
+    co_await reader.read(ctx);
+
+    /*
+     * A collection awaiting I/O doesn't hold up the others. They are all
+     * joined before the cycle is published, so the shared memory and the
+     * snapshots see the values of the same cycle.
+     */
+    sdbusplus::async::scope scope;
+    for (auto& [type, collection] : collections)
+    {
+        debug("Reading Health Metric Collection for {TYPE}", "TYPE", type);
+        scope.spawn(collection->read(ctx));
+    }
+    co_await scope.empty();
+
+    if (sharedMemory)
+    {
+        sharedMemory->commit();
+    }
+    if (snapshots)
+    {
+        snapshots->poll();
     }
 }
 
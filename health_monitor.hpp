@@ -4,6 +4,7 @@
 
 #include <sdbusplus/async.hpp>
 
+#include <string>
 #include <unordered_map>
 
 namespace phosphor::health::monitor
@@ -16,17 +17,29 @@ class HealthMonitor
   public:
     HealthMonitor() = delete;
 
-    explicit HealthMonitor(sdbusplus::async::context& ctx) :
-        ctx(ctx), configs(ConfigIntf::getHealthMetricConfigs())
-    {
-        ctx.spawn(startup());
-    }
+    explicit HealthMonitor(sdbusplus::async::context& ctx);
 
   private:
     /** @brief Setup and run a new health monitor object */
     auto startup() -> sdbusplus::async::task<>;
     /** @brief Run the health monitor */
     auto run() -> sdbusplus::async::task<>;
+    /** @brief Collect all the health metrics once, with the collections
+     *         read concurrently */
+    auto collect() -> sdbusplus::async::task<>;
+    /** @brief Query the object mapper for the BMC inventory paths, until it
+     *         answers */
+    auto findBmcPaths() -> sdbusplus::async::task<>;
+    /** @brief Track BMC inventory objects being added */
+    auto watchBmcAdded() -> sdbusplus::async::task<>;
+    /** @brief Track BMC inventory objects being removed */
+    auto watchBmcRemoved() -> sdbusplus::async::task<>;
+    /** @brief Track the main PIDs of the services of the process metrics */
+    auto watchServices() -> sdbusplus::async::task<>;
+    /** @brief Query the main PID of a systemd service unit */
+    auto queryMainPid(const std::string& unit) -> sdbusplus::async::task<>;
+    /** @brief Push the known BMC inventory paths to all collections */
+    void updateAssociations();
 
     using map_t = std::unordered_map<
         MetricIntf::Type,
@@ -36,7 +49,25 @@ class HealthMonitor
     sdbusplus::async::context& ctx;
     /** @brief Health metric configs */
     ConfigIntf::HealthMetric::map_t configs;
+    /** @brief Batch reader for the files of all collections */
+    phosphor::health::reader::BatchReader reader;
+    /** @brief OpenMetrics exporter, if enabled */
+    std::unique_ptr<phosphor::health::exporter::Exporter> exporter;
+    /** @brief Shared memory segment writer, if enabled */
+    std::unique_ptr<phosphor::health::shm::Writer> sharedMemory;
+    /** @brief Diagnostic snapshots on severe assertions, if enabled */
+    std::unique_ptr<phosphor::health::snapshot::Snapshotter> snapshots;
     map_t collections;
+    /** @brief BMC inventory paths measured by the health metrics */
+    MetricIntf::paths_t bmcPaths;
+    /** @brief Match for BMC inventory InterfacesAdded signals */
+    sdbusplus::async::match bmcAddedMatch;
+    /** @brief Match for BMC inventory InterfacesRemoved signals */
+    sdbusplus::async::match bmcRemovedMatch;
+    /** @brief Services of the process metrics by systemd unit path */
+    std::unordered_map<std::string, std::string> units;
+    /** @brief Number of collection ticks skipped on overrun */
+    uint64_t overruns = 0;
 };
 
 } // namespace phosphor::health::monitor
@@ -0,0 +1,162 @@
+#include "health_mounts.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <ranges>
+
+extern "C"
+{
+#include <fnmatch.h>
+#include <poll.h>
+#include <unistd.h>
+}
+
+PHOSPHOR_LOG2_USING;
+
+namespace phosphor::health::mounts
+{
+
+using phosphor::health::utils::openFile;
+
+/** @brief Filesystems without storage of their own */
+static constexpr auto pseudoFsTypes = std::to_array<std::string_view>(
+    {"autofs", "binfmt_misc", "bpf", "cgroup", "cgroup2", "configfs",
+     "debugfs", "devpts", "devtmpfs", "efivarfs", "fusectl", "hugetlbfs",
+     "mqueue", "nsfs", "proc", "pstore", "ramfs", "rpc_pipefs", "securityfs",
+     "sysfs", "tracefs"});
+
+/** @brief Size of the reads of the mount table */
+static constexpr size_t chunkSize = 4096;
+
+/** @brief Unescape the octal escapes of a mountinfo field, e.g. "\040" */
+static auto unescape(std::string_view field) -> std::string
+{
+    std::string result;
+    result.reserve(field.size());
+    for (size_t i = 0; i < field.size(); i++)
+    {
+        if (field[i] == '\\' && i + 3 < field.size() &&
+            std::ranges::all_of(field.substr(i + 1, 3),
+                                [](char c) { return c >= '0' && c <= '7'; }))
+        {
+            result += static_cast<char>((field[i + 1] - '0') * 64 +
+                                        (field[i + 2] - '0') * 8 +
+                                        (field[i + 3] - '0'));
+            i += 3;
+        }
+        else
+        {
+            result += field[i];
+        }
+    }
+    return result;
+}
+
+/** @brief Check whether a comma separated list of options has the option */
+static auto hasOption(std::string_view options, std::string_view option)
+    -> bool
+{
+    return std::ranges::any_of(std::views::split(options, ','),
+                               [option](auto&& token) {
+                                   return std::string_view(token) == option;
+                               });
+}
+
+auto parse(std::string_view mountinfo) -> std::vector<Mount>
+{
+    std::vector<Mount> mounts;
+    for (auto&& line : std::views::split(mountinfo, '\n'))
+    {
+        /*
+         * ID, parent ID, major:minor, root, mount point, mount options,
+         * optional fields up to "-", filesystem type, source and super
+         * options.
+         */
+        std::vector<std::string_view> fields;
+        for (auto&& field : std::views::split(std::string_view(line), ' '))
+        {
+            fields.emplace_back(field);
+        }
+        auto separator = std::ranges::find(fields, "-");
+        if (fields.size() < 6 || separator == fields.end() ||
+            fields.end() - separator < 4)
+        {
+            continue;
+        }
+
+        mounts.push_back(
+            {.point = unescape(fields[4]),
+             .fsType = std::string(separator[1]),
+             .writable = hasOption(fields[5], "rw") &&
+                         !hasOption(separator[3], "ro")});
+    }
+    return mounts;
+}
+
+auto Filter::matches(const Mount& mount) const -> bool
+{
+    if (!mount.writable ||
+        std::ranges::find(pseudoFsTypes, mount.fsType) != pseudoFsTypes.end())
+    {
+        return false;
+    }
+
+    auto matchesPattern = [&mount](const std::string& pattern) {
+        return fnmatch(pattern.c_str(), mount.point.c_str(), 0) == 0 ||
+               fnmatch(pattern.c_str(), mount.fsType.c_str(), 0) == 0;
+    };
+    return (include.empty() || std::ranges::any_of(include, matchesPattern)) &&
+           std::ranges::none_of(exclude, matchesPattern);
+}
+
+MountTable::MountTable(const std::string& path) :
+    path(path), file(openFile(path))
+{
+    if (!file)
+    {
+        error("Failed to open the mount table {PATH}: {ERROR}", "PATH", path,
+              "ERROR", strerror(errno));
+    }
+}
+
+auto MountTable::changed() -> bool
+{
+    /*
+     * The kernel flags the open table with POLLPRI and POLLERR once the mount
+     * namespace changed, and the flag is cleared by polling it.
+     */
+    pollfd fd{.fd = file.get(), .events = POLLPRI, .revents = 0};
+    return file && poll(&fd, 1, 0) > 0 &&
+           (fd.revents & (POLLPRI | POLLERR)) != 0;
+}
+
+auto MountTable::read() -> std::vector<Mount>
+{
+    // A read of the table returns about a page of it at most, so read on
+    // until the end rather than into a buffer sized for it
+    size_t size = 0;
+    while (file)
+    {
+        content.resize(size + chunkSize);
+        auto count = pread(file.get(), content.data() + size, chunkSize, size);
+        if (count < 0)
+        {
+            error("Failed to read the mount table {PATH}: {ERROR}", "PATH",
+                  path, "ERROR", strerror(errno));
+            return {};
+        }
+        if (count == 0)
+        {
+            break;
+        }
+        size += count;
+    }
+    content.resize(size);
+    return parse(content);
+}
+
+} // namespace phosphor::health::mounts
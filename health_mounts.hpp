@@ -0,0 +1,76 @@
+#pragma once
+
+#include "health_utils.hpp"
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace phosphor::health::mounts
+{
+
+using phosphor::health::utils::FileDescriptor;
+
+/** @brief Mount from the mount table */
+struct Mount
+{
+    /** @brief Mount point, unescaped */
+    std::string point;
+    /** @brief Filesystem type, e.g. "ext4" */
+    std::string fsType;
+    /** @brief Mounted read-write on a filesystem which isn't read-only */
+    bool writable = false;
+};
+
+/** @brief Parse the mounts of a mountinfo file, e.g. /proc/self/mountinfo */
+auto parse(std::string_view mountinfo) -> std::vector<Mount>;
+
+/** @brief Filter of the mounts to be monitored.
+ *
+ *  A mount passes if it is writable, isn't on a pseudo filesystem like proc
+ *  or sysfs, matches one of the include patterns (all if there are none) and
+ *  none of the exclude patterns. The shell patterns are matched against both
+ *  the mount point and the filesystem type, e.g. "/mnt/usb*" or "tmpfs".
+ */
+class Filter
+{
+  public:
+    Filter(std::vector<std::string> include, std::vector<std::string> exclude) :
+        include(std::move(include)), exclude(std::move(exclude))
+    {}
+
+    /** @brief Whether the mount passes the filter */
+    auto matches(const Mount& mount) const -> bool;
+
+  private:
+    std::vector<std::string> include;
+    std::vector<std::string> exclude;
+};
+
+/** @brief Mount table of the process, which is kept open so its changes are
+ *         signaled by the kernel rather than found by re-reading it.
+ */
+class MountTable
+{
+  public:
+    static constexpr auto defaultPath = "/proc/self/mountinfo";
+
+    explicit MountTable(const std::string& path = defaultPath);
+
+    /** @brief Whether the kernel signaled a change of the mount table since
+     *         the last check, without blocking */
+    auto changed() -> bool;
+    /** @brief Read the mounts of the table */
+    auto read() -> std::vector<Mount>;
+
+  private:
+    /** @brief Path of the table */
+    std::string path;
+    /** @brief Open table, polled for POLLPRI */
+    FileDescriptor file;
+    /** @brief Content of the table, which keeps its capacity */
+    std::string content;
+};
+
+} // namespace phosphor::health::mounts
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+extern "C"
+{
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+}
+
+/** @file Layout of the shared memory segment of the health monitor, and a
+ *        header-only reader for it.
+ *
+ *  The segment is a Header followed by Header::capacity entries, of which
+ *  the first Header::count are in use. The monitor writes all the entries
+ *  once per collection cycle under a seqlock: the sequence is odd while the
+ *  entries are being written, so a reader retries when it is odd or when it
+ *  changed while copying. Reads don't make any syscall.
+ */
+namespace phosphor::health::shm
+{
+
+/** @brief "HMON" */
+inline constexpr uint32_t magic = 0x484d4f4e;
+inline constexpr uint32_t version = 1;
+inline constexpr size_t nameSize = 64;
+
+/** @brief Flags of an entry */
+enum Flags : uint32_t
+{
+    /** @brief The value couldn't be read in time */
+    stale = 1 << 0,
+    /** @brief A threshold of the metric is asserted */
+    asserted = 1 << 1,
+};
+
+/** @brief Metric entry */
+struct Entry
+{
+    /** @brief Metric name, null terminated */
+    char name[nameSize];
+    /** @brief Current value */
+    double value;
+    /** @brief Statistic of the window compared against the thresholds */
+    double window;
+    /** @brief Time of the last update, CLOCK_MONOTONIC in nanoseconds */
+    uint64_t timestamp;
+    /** @brief Flags of the entry */
+    uint32_t flags;
+    uint32_t reserved;
+};
+
+/** @brief Segment header */
+struct Header
+{
+    uint32_t magic;
+    uint32_t version;
+    /** @brief Number of entries in the segment */
+    uint32_t capacity;
+    /** @brief Number of entries in use */
+    uint32_t count;
+    /** @brief Time of the last write, CLOCK_MONOTONIC in nanoseconds */
+    uint64_t timestamp;
+    /** @brief Seqlock sequence, odd while writing */
+    alignas(64) std::atomic<uint64_t> sequence;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+/** @brief Get the size of a segment with the given capacity */
+inline constexpr auto segmentSize(size_t capacity) -> size_t
+{
+    return sizeof(Header) + capacity * sizeof(Entry);
+}
+
+/** @brief Reader for the shared memory segment */
+class Reader
+{
+  public:
+    /** @brief Map the segment, e.g. "/healthMon" */
+    explicit Reader(const std::string& name)
+    {
+        int fd = shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+        if (fd < 0)
+        {
+            throw std::system_error(errno, std::generic_category(), name);
+        }
+        struct stat st{};
+        if (fstat(fd, &st) != 0 ||
+            static_cast<size_t>(st.st_size) < sizeof(Header))
+        {
+            close(fd);
+            throw std::system_error(EINVAL, std::generic_category(), name);
+        }
+        size = st.st_size;
+        base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED)
+        {
+            throw std::system_error(errno, std::generic_category(), name);
+        }
+        header = static_cast<const Header*>(base);
+        if (header->magic != magic || header->version != version ||
+            segmentSize(header->capacity) > size)
+        {
+            munmap(base, size);
+            throw std::system_error(EPROTO, std::generic_category(), name);
+        }
+        entries = reinterpret_cast<const Entry*>(header + 1);
+    }
+
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    ~Reader()
+    {
+        munmap(base, size);
+    }
+
+    /** @brief Copy a consistent snapshot of all the entries in use, and get
+     *         the time it was written */
+    auto snapshot(std::vector<Entry>& snapshot) const -> uint64_t
+    {
+        snapshot.resize(header->capacity);
+        while (true)
+        {
+            auto sequence = header->sequence.load(std::memory_order_acquire);
+            if (sequence & 1)
+            {
+                continue;
+            }
+            auto count = std::min(header->count, header->capacity);
+            auto timestamp = header->timestamp;
+            std::memcpy(snapshot.data(), entries, count * sizeof(Entry));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (header->sequence.load(std::memory_order_relaxed) == sequence)
+            {
+                snapshot.resize(count);
+                return timestamp;
+            }
+        }
+    }
+
+    /** @brief Copy a consistent snapshot of one entry */
+    auto read(size_t index) const -> std::optional<Entry>
+    {
+        if (index >= header->capacity)
+        {
+            return std::nullopt;
+        }
+        Entry entry;
+        while (true)
+        {
+            auto sequence = header->sequence.load(std::memory_order_acquire);
+            if (sequence & 1)
+            {
+                continue;
+            }
+            auto count = header->count;
+            std::memcpy(&entry, &entries[index], sizeof(Entry));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (header->sequence.load(std::memory_order_relaxed) == sequence)
+            {
+                if (index >= count)
+                {
+                    return std::nullopt;
+                }
+                return entry;
+            }
+        }
+    }
+
+    /** @brief Find the index of the metric by name, which doesn't change for
+     *         the lifetime of the monitor */
+    auto find(std::string_view name) const -> std::optional<size_t>
+    {
+        for (size_t index = 0; index < header->capacity; index++)
+        {
+            auto entry = read(index);
+            if (entry && std::string_view(entry->name) == name)
+            {
+                return index;
+            }
+        }
+        return std::nullopt;
+    }
+
+  private:
+    /** @brief Mapping of the segment */
+    void* base = nullptr;
+    /** @brief Size of the mapping */
+    size_t size = 0;
+    const Header* header = nullptr;
+    const Entry* entries = nullptr;
+};
+
+} // namespace phosphor::health::shm
@@ -0,0 +1,128 @@
+#include "health_shm_writer.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <limits>
+
+PHOSPHOR_LOG2_USING;
+
+namespace phosphor::health::shm
+{
+
+namespace
+{
+
+/** @brief Get CLOCK_MONOTONIC in nanoseconds */
+auto monotonicNow() -> uint64_t
+{
+    timespec now{};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+} // namespace
+
+Writer::Writer(const std::string& name) : name(name) {}
+
+Writer::~Writer()
+{
+    if (header != nullptr)
+    {
+        munmap(header, size);
+        shm_unlink(name.c_str());
+    }
+}
+
+auto Writer::add(const std::string& metric) -> std::optional<size_t>
+{
+    /*
+     * Don't truncate the names which don't fit, two names sharing a prefix
+     * would show up to the readers as the same metric.
+     */
+    if (metric.size() >= nameSize)
+    {
+        error("Metric {METRIC} not shared, its name is longer than {MAX} "
+              "characters",
+              "METRIC", metric, "MAX", nameSize - 1);
+        return std::nullopt;
+    }
+    if (header != nullptr)
+    {
+        warning("Metric {METRIC} added after the shared memory was created",
+                "METRIC", metric);
+    }
+    Entry entry{};
+    metric.copy(entry.name, metric.size());
+    entry.value = std::numeric_limits<double>::quiet_NaN();
+    entry.window = std::numeric_limits<double>::quiet_NaN();
+    entries.push_back(entry);
+    return entries.size() - 1;
+}
+
+void Writer::set(size_t index, double value, double window, uint32_t flags)
+{
+    auto& entry = entries[index];
+    entry.value = value;
+    entry.window = window;
+    entry.flags = flags;
+    entry.timestamp = monotonicNow();
+}
+
+void Writer::commit()
+{
+    if (header == nullptr && !map())
+    {
+        return;
+    }
+
+    auto count = std::min<size_t>(entries.size(), header->capacity);
+    auto sequence = header->sequence.load(std::memory_order_relaxed);
+    header->sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    header->count = count;
+    header->timestamp = monotonicNow();
+    std::memcpy(reinterpret_cast<Entry*>(header + 1), entries.data(),
+                count * sizeof(Entry));
+
+    header->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+auto Writer::map() -> bool
+{
+    auto capacity = entries.size();
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        error("Failed to create shared memory {NAME}: {ERROR}", "NAME", name,
+              "ERROR", strerror(errno));
+        return false;
+    }
+    size = segmentSize(capacity);
+    void* base = MAP_FAILED;
+    if (ftruncate(fd, size) == 0)
+    {
+        base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (base == MAP_FAILED)
+    {
+        error("Failed to map shared memory {NAME}: {ERROR}", "NAME", name,
+              "ERROR", strerror(errno));
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    header = new (base) Header{};
+    header->magic = magic;
+    header->version = version;
+    header->capacity = capacity;
+    info("Publishing {COUNT} metrics to shared memory {NAME}", "COUNT",
+         capacity, "NAME", name);
+    return true;
+}
+
+} // namespace phosphor::health::shm
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "health_shm.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace phosphor::health::shm
+{
+
+/** @brief Writer for the shared memory segment.
+ *
+ *  The metrics update their entries in a private copy, which is written to
+ *  the segment with a single memcpy under the seqlock once per cycle. The
+ *  segment is sized for the entries added before the first commit.
+ */
+class Writer
+{
+  public:
+    /** @brief Create the segment, e.g. "/healthMon" */
+    explicit Writer(const std::string& name);
+    Writer(const Writer&) = delete;
+    Writer& operator=(const Writer&) = delete;
+    ~Writer();
+
+    /** @brief Add an entry for the metric, before the first commit. No
+     *         entry is added if the name doesn't fit in the entry. */
+    auto add(const std::string& name) -> std::optional<size_t>;
+    /** @brief Update the entry of a metric */
+    void set(size_t index, double value, double window, uint32_t flags);
+    /** @brief Write all the entries to the segment */
+    void commit();
+
+  private:
+    /** @brief Create and map the segment for the added entries */
+    auto map() -> bool;
+
+    /** @brief Name of the segment */
+    std::string name;
+    /** @brief Private copy of the entries */
+    std::vector<Entry> entries;
+    /** @brief Mapping of the segment */
+    Header* header = nullptr;
+    /** @brief Size of the mapping */
+    size_t size = 0;
+};
+
+} // namespace phosphor::health::shm
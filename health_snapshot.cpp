@@ -0,0 +1,288 @@
+#include "health_snapshot.hpp"
+
+#include <phosphor-logging/lg2.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <sstream>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+extern "C"
+{
+#include <unistd.h>
+}
+
+PHOSPHOR_LOG2_USING;
+
+namespace phosphor::health::snapshot
+{
+
+namespace
+{
+
+/** @brief Files captured as they are */
+constexpr auto diagnosticFiles = {"/proc/meminfo", "/proc/pressure/cpu",
+                                  "/proc/pressure/memory", "/proc/pressure/io"};
+/** @brief Processes listed by CPU and by RSS */
+constexpr size_t topProcesses = 10;
+/** @brief Time over which the CPU usage of the processes is measured */
+constexpr auto cpuSampleTime = std::chrono::milliseconds(500);
+
+struct Process
+{
+    std::string name;
+    /** @brief CPU time since the process started, in clock ticks */
+    uint64_t ticks = 0;
+    /** @brief Resident set size in pages */
+    uint64_t rss = 0;
+    /** @brief CPU usage over the sample time, in percent of a CPU */
+    double cpu = 0;
+};
+
+auto readText(const std::filesystem::path& path) -> std::optional<std::string>
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        return std::nullopt;
+    }
+    return std::string(std::istreambuf_iterator<char>(file), {});
+}
+
+/** @brief Parse a numeric field, which may be empty or out of range for a
+ *         process which exited meanwhile */
+auto parseField(std::string_view field) -> std::optional<uint64_t>
+{
+    uint64_t value = 0;
+    auto [end, error] =
+        std::from_chars(field.data(), field.data() + field.size(), value);
+    if (error != std::errc{} || end != field.data() + field.size())
+    {
+        return std::nullopt;
+    }
+    return value;
+}
+
+/** @brief Get the CPU time and RSS of all processes from /proc/<pid>/stat */
+auto scanProcesses() -> std::unordered_map<int, Process>
+{
+    std::unordered_map<int, Process> processes;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator("/proc", ec))
+    {
+        auto name = entry.path().filename().string();
+        int pid = 0;
+        auto [end, error] =
+            std::from_chars(name.data(), name.data() + name.size(), pid);
+        if (error != std::errc{} || end != name.data() + name.size())
+        {
+            continue;
+        }
+        // The process may have exited since the directory was listed
+        auto stat = readText(entry.path() / "stat");
+        if (!stat)
+        {
+            continue;
+        }
+        // The command may have spaces and parentheses, it ends at the last one
+        auto open = stat->find('(');
+        auto close = stat->rfind(')');
+        if (open == std::string::npos || close == std::string::npos ||
+            close < open)
+        {
+            continue;
+        }
+        // The fields after the command, from the state
+        std::istringstream fields(stat->substr(close + 1));
+        std::vector<std::string> values{std::istream_iterator<std::string>(
+                                            fields),
+                                        {}};
+        constexpr size_t utime = 11;
+        constexpr size_t stime = 12;
+        constexpr size_t rss = 21;
+        if (values.size() <= rss)
+        {
+            continue;
+        }
+        // Parsed without exceptions, which would terminate the worker
+        auto user = parseField(values[utime]);
+        auto system = parseField(values[stime]);
+        auto pages = parseField(values[rss]);
+        if (!user || !system || !pages)
+        {
+            continue;
+        }
+        processes.emplace(
+            pid, Process{.name = stat->substr(open + 1, close - open - 1),
+                         .ticks = *user + *system,
+                         .rss = *pages});
+    }
+    return processes;
+}
+
+/** @brief Append the processes with the highest key to the report */
+template <typename Key, typename Format>
+void appendTop(std::string& report,
+               std::vector<std::pair<int, Process>>& processes, Key key,
+               Format format)
+{
+    auto count = std::min(topProcesses, processes.size());
+    std::ranges::partial_sort(processes, processes.begin() + count,
+                              std::ranges::greater{}, key);
+    for (size_t i = 0; i < count; i++)
+    {
+        auto& [pid, process] = processes[i];
+        std::format_to(std::back_inserter(report), "{:>8} {:>12} {}\n", pid,
+                       format(process), process.name);
+    }
+}
+
+/** @brief Capture the diagnostic data of the system in a report */
+auto report(const Trigger& trigger) -> std::string
+{
+    std::string report;
+    auto out = std::back_inserter(report);
+    std::format_to(out,
+                   "Health monitor snapshot\nTime: {:%FT%TZ}\nMetric: {}\n"
+                   "Threshold: {}\nValue: {}\n",
+                   std::chrono::floor<std::chrono::seconds>(
+                       std::chrono::system_clock::now()),
+                   trigger.metric, trigger.threshold, trigger.value);
+
+    report += "\n== History ==\n";
+    for (const auto& sample : trigger.history)
+    {
+        auto age = std::chrono::duration<double>(
+            trigger.history.back().timestamp - sample.timestamp);
+        std::format_to(out, "-{:.1f}s {}\n", age.count(), sample.value);
+    }
+
+    // The CPU usage is the CPU time of the processes over the sample time
+    static const auto ticksPerSecond = sysconf(_SC_CLK_TCK);
+    static const auto pageSize = sysconf(_SC_PAGE_SIZE);
+    auto before = scanProcesses();
+    std::this_thread::sleep_for(cpuSampleTime);
+    auto after = scanProcesses();
+    std::vector<std::pair<int, Process>> processes;
+    processes.reserve(after.size());
+    for (auto& [pid, process] : after)
+    {
+        auto previous = before.find(pid);
+        if (previous != before.end() && process.ticks >= previous->second.ticks)
+        {
+            process.cpu =
+                100.0 * (process.ticks - previous->second.ticks) /
+                (ticksPerSecond *
+                 std::chrono::duration<double>(cpuSampleTime).count());
+        }
+        processes.emplace_back(pid, std::move(process));
+    }
+
+    report += "\n== Top processes by CPU ==\n     PID         CPU% COMMAND\n";
+    appendTop(
+        report, processes, [](auto& p) { return p.second.cpu; },
+        [](const Process& p) { return std::format("{:.1f}", p.cpu); });
+    report += "\n== Top processes by RSS ==\n     PID     RSS(KiB) COMMAND\n";
+    appendTop(
+        report, processes, [](auto& p) { return p.second.rss; },
+        [](const Process& p) {
+            return std::to_string(p.rss * pageSize / 1024);
+        });
+
+    for (const auto* file : diagnosticFiles)
+    {
+        std::format_to(out, "\n== {} ==\n{}", file,
+                       readText(file).value_or("unavailable\n"));
+    }
+    return report;
+}
+
+} // namespace
+
+Snapshotter::Snapshotter(const std::filesystem::path& directory,
+                         clock::duration cooldown, size_t maxFiles,
+                         size_t maxSize) :
+    directory(directory), cooldown(cooldown),
+    maxFiles(std::max<size_t>(maxFiles, 1)), maxSize(maxSize), workers(1)
+{}
+
+auto Snapshotter::capture(Trigger trigger) -> bool
+{
+    auto now = clock::now();
+    if (last != clock::time_point{} && now - last < cooldown)
+    {
+        debug("Skipped the snapshot for {METRIC} in the cooldown", "METRIC",
+              trigger.metric);
+        return false;
+    }
+    last = now;
+
+    workers.submit([directory = directory, maxFiles = maxFiles,
+                    maxSize = maxSize,
+                    trigger = std::move(trigger)]() -> Result {
+        auto content = report(trigger);
+        if (content.size() > maxSize)
+        {
+            constexpr std::string_view truncated = "\n[truncated]\n";
+            content.resize(maxSize - std::min(maxSize, truncated.size()));
+            content += truncated;
+        }
+
+        auto file = [&](size_t index) {
+            return directory / std::format("{}.{}", prefix, index);
+        };
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+        if (ec)
+        {
+            return {.path = directory, .error = ec.message()};
+        }
+        // Rotate the older snapshots, the oldest one is replaced
+        for (auto index = maxFiles - 1; index > 0; index--)
+        {
+            std::filesystem::rename(file(index - 1), file(index), ec);
+        }
+
+        // Written aside, so a partial snapshot never takes the place of one
+        auto temporary = file(0);
+        temporary += ".tmp";
+        {
+            std::ofstream output(temporary, std::ios::trunc);
+            output << content;
+            if (!output.flush())
+            {
+                return {.path = temporary, .error = "write failed"};
+            }
+        }
+        std::filesystem::rename(temporary, file(0), ec);
+        if (ec)
+        {
+            return {.path = file(0), .error = ec.message()};
+        }
+        return {.path = file(0), .error = {}};
+    });
+    return true;
+}
+
+void Snapshotter::poll()
+{
+    workers.poll([](const Result& result) {
+        if (!result.error.empty())
+        {
+            error("Failed to write the snapshot {PATH}: {ERROR}", "PATH",
+                  result.path.string(), "ERROR", result.error);
+            return;
+        }
+        info("Captured a diagnostic snapshot in {PATH}", "PATH",
+             result.path.string());
+    });
+}
+
+} // namespace phosphor::health::snapshot
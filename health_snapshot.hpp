@@ -0,0 +1,80 @@
+#pragma once
+
+#include "health_metric_aggregator.hpp"
+#include "health_worker.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace phosphor::health::snapshot
+{
+
+/** @brief What a snapshot is taken for */
+struct Trigger
+{
+    /** @brief Name of the metric */
+    std::string metric;
+    /** @brief Threshold which was asserted, e.g. "Critical_Upper" */
+    std::string threshold;
+    /** @brief Value which asserted the threshold */
+    double value;
+    /** @brief Recent history of the metric */
+    std::vector<metric::aggregator::Sample> history;
+};
+
+/** @brief Capture of diagnostic data when a threshold asserts.
+ *
+ *  The culprit of a threshold is usually gone by the time someone looks, so
+ *  the memory, pressure and top processes are captured along with the
+ *  history of the metric, to a rotating set of size bounded files. The
+ *  capture runs on a worker, off the collection path, and at most once per
+ *  cooldown, so a storm of assertions doesn't cost more than one.
+ */
+class Snapshotter
+{
+  public:
+    using clock = std::chrono::steady_clock;
+
+    /** @brief Name of the files, the newest with suffix .0 */
+    static constexpr auto prefix = "snapshot";
+
+    Snapshotter(const std::filesystem::path& directory,
+                clock::duration cooldown, size_t maxFiles, size_t maxSize);
+    Snapshotter(const Snapshotter&) = delete;
+    Snapshotter& operator=(const Snapshotter&) = delete;
+
+    /** @brief Capture a snapshot, unless one was within the cooldown.
+     *  @return Whether a snapshot was submitted */
+    auto capture(Trigger trigger) -> bool;
+
+    /** @brief Log the outcome of the completed snapshots */
+    void poll();
+
+  private:
+    /** @brief Outcome of a snapshot */
+    struct Result
+    {
+        /** @brief Path of the file written */
+        std::filesystem::path path;
+        /** @brief Error, empty on success */
+        std::string error;
+    };
+
+    /** @brief Directory of the files */
+    std::filesystem::path directory;
+    /** @brief Minimum time between two snapshots */
+    clock::duration cooldown;
+    /** @brief Number of files kept */
+    size_t maxFiles;
+    /** @brief Maximum size of a file */
+    size_t maxSize;
+    /** @brief Time of the last snapshot, unset before the first one */
+    clock::time_point last;
+    /** @brief Worker writing the snapshots */
+    worker::WorkerPool<Result> workers;
+};
+
+} // namespace phosphor::health::snapshot
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "config.h"
+
+/*
+ * Static tracepoints (USDT) of the collection pipeline, for perf, bpftrace
+ * or LTTng, under the provider phosphor_health_monitor:
+ *
+ *  - cycle_start(): a collection cycle starts
+ *  - cycle_end(missed): a collection cycle ends, with the ticks it overran
+ *  - collection_start(type): a collection starts reading its metrics
+ *  - collection_end(type, ok): a collection read its metrics
+ *  - metric_update(name, milli): a metric is updated, in thousandths
+ *  - threshold_assert(name, type, bound, milli): a threshold asserts
+ *  - threshold_deassert(name, type, bound, milli): a threshold deasserts
+ *  - start_unit(unit): a systemd unit is started for a threshold
+ *
+ * Values are passed in thousandths as integers, as floating point arguments
+ * aren't supported by the probes on all architectures, and the types and
+ * bounds as the values of their enums. Without the tracing
+ * feature, the tracepoints and their arguments compile to nothing.
+ */
+
+#include <cmath>
+#include <cstdint>
+
+#if HAVE_TRACING
+#include <sys/sdt.h>
+
+#define HEALTH_TRACE(name, ...)                                                \
+    STAP_PROBEV(phosphor_health_monitor, name __VA_OPT__(, ) __VA_ARGS__)
+#else
+#define HEALTH_TRACE(name, ...)                                                \
+    do                                                                         \
+    {                                                                          \
+    } while (false)
+#endif
+
+namespace phosphor::health::trace
+{
+
+/** @brief Get a value as an integer tracepoint argument, in thousandths,
+ *         0 if it isn't finite */
+inline auto milli(double value) -> int64_t
+{
+    return std::isfinite(value) ? static_cast<int64_t>(value * 1000) : 0;
+}
+
+} // namespace phosphor::health::trace
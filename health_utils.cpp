@@ -1,15 +1,64 @@
 #include "health_utils.hpp"
 
+#include "health_trace.hpp"
+
 #include <phosphor-logging/lg2.hpp>
 #include <xyz/openbmc_project/ObjectMapper/client.hpp>
 
 #include <unordered_set>
 
+extern "C"
+{
+#include <fcntl.h>
+#include <unistd.h>
+}
+
 PHOSPHOR_LOG2_USING;
 
 namespace phosphor::health::utils
 {
 
+FileDescriptor& FileDescriptor::operator=(FileDescriptor&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        fd = std::exchange(other.fd, -1);
+    }
+    return *this;
+}
+
+FileDescriptor::~FileDescriptor()
+{
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+auto openFile(const std::string& path) -> FileDescriptor
+{
+    return FileDescriptor(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+}
+
+auto readFile(const FileDescriptor& file, std::span<char> buffer)
+    -> std::optional<std::string_view>
+{
+    if (!file)
+    {
+        return std::nullopt;
+    }
+    auto size = pread(file.get(), buffer.data(), buffer.size(), 0);
+    if (size < 0)
+    {
+        return std::nullopt;
+    }
+    return std::string_view(buffer.data(), size);
+}
+
 static const std::unordered_set<std::string> systemdReplaceIrreversiblyTarget{
     "halt.target",        "poweroff.target", "reboot.target",
     "soft-reboot.target", "kexec.target",    "exit.target"};
@@ -20,6 +69,7 @@ void startUnit(sdbusplus::bus_t& bus, const std::string& sysdUnit)
     {
         return;
     }
+    HEALTH_TRACE(start_unit, sysdUnit.c_str());
     sdbusplus::message_t msg = bus.new_method_call(
         "org.freedesktop.systemd1", "/org/freedesktop/systemd1",
         "org.freedesktop.systemd1.Manager", "StartUnit");
@@ -37,24 +87,15 @@ void startUnit(sdbusplus::bus_t& bus, const std::string& sysdUnit)
 auto findPaths(sdbusplus::async::context& ctx, const std::string& iface,
                const std::string& subpath) -> sdbusplus::async::task<paths_t>
 {
-    try
-    {
-        using ObjectMapper =
-            sdbusplus::client::xyz::openbmc_project::ObjectMapper<>;
+    using ObjectMapper =
+        sdbusplus::client::xyz::openbmc_project::ObjectMapper<>;
 
-        auto mapper = ObjectMapper(ctx)
-                          .service(ObjectMapper::default_service)
-                          .path(ObjectMapper::instance_path);
+    auto mapper = ObjectMapper(ctx)
+                      .service(ObjectMapper::default_service)
+                      .path(ObjectMapper::instance_path);
 
-        std::vector<std::string> ifaces = {iface};
-        co_return co_await mapper.get_sub_tree_paths(subpath, 0, ifaces);
-    }
-    catch (std::exception& e)
-    {
-        error("Exception occurred for GetSubTreePaths for {PATH}: {ERROR}",
-              "PATH", subpath, "ERROR", e);
-    }
-    co_return {};
+    std::vector<std::string> ifaces = {iface};
+    co_return co_await mapper.get_sub_tree_paths(subpath, 0, ifaces);
 }
 
 } // namespace phosphor::health::utils
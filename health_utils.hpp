@@ -4,6 +4,10 @@
 #include <sdbusplus/bus.hpp>
 #include <sdbusplus/sdbus.hpp>
 
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 namespace phosphor::health::utils
@@ -11,9 +15,45 @@ namespace phosphor::health::utils
 
 using paths_t = std::vector<std::string>;
 
+/** @brief File descriptor which is closed when it goes out of scope */
+class FileDescriptor
+{
+  public:
+    FileDescriptor() = default;
+    explicit FileDescriptor(int fd) : fd(fd) {}
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+    FileDescriptor(FileDescriptor&& other) noexcept :
+        fd(std::exchange(other.fd, -1))
+    {}
+    FileDescriptor& operator=(FileDescriptor&& other) noexcept;
+    ~FileDescriptor();
+
+    /** @brief Get the raw file descriptor */
+    auto get() const -> int
+    {
+        return fd;
+    }
+
+    explicit operator bool() const
+    {
+        return fd >= 0;
+    }
+
+  private:
+    int fd = -1;
+};
+
+/** @brief Open a file read-only, to be kept open and re-read from offset 0 */
+auto openFile(const std::string& path) -> FileDescriptor;
+/** @brief Read the content of an open file from offset 0 into the buffer */
+auto readFile(const FileDescriptor& file, std::span<char> buffer)
+    -> std::optional<std::string_view>;
+
 /** @brief Start a systemd unit */
 void startUnit(sdbusplus::bus_t& bus, const std::string& sysdUnit);
-/** @brief Find D-Bus paths for given interface */
+/** @brief Find D-Bus paths for given interface, throws if the object mapper
+ *         didn't answer */
 auto findPaths(sdbusplus::async::context& ctx, const std::string& iface,
                const std::string& subpath) -> sdbusplus::async::task<paths_t>;
 
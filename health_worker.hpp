@@ -0,0 +1,247 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+extern "C"
+{
+#include <sys/eventfd.h>
+#include <unistd.h>
+}
+
+namespace phosphor::health::worker
+{
+
+/** @brief Lock-free single producer, single consumer bounded queue */
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert((Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two");
+
+  public:
+    /** @brief Push a value from the producer, false if the queue is full */
+    auto push(T&& value) -> bool
+    {
+        auto t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity)
+        {
+            return false;
+        }
+        items[t & (Capacity - 1)] = std::move(value);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** @brief Pop a value from the consumer, if any */
+    auto pop() -> std::optional<T>
+    {
+        auto h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+        {
+            return std::nullopt;
+        }
+        std::optional<T> value = std::move(items[h & (Capacity - 1)]);
+        head.store(h + 1, std::memory_order_release);
+        return value;
+    }
+
+  private:
+    /** @brief Queue storage */
+    std::array<T, Capacity> items{};
+    /** @brief Index of the next value to pop, written by the consumer */
+    alignas(64) std::atomic<size_t> head = 0;
+    /** @brief Index of the next value to push, written by the producer */
+    alignas(64) std::atomic<size_t> tail = 0;
+};
+
+/** @brief Pool of threads for potentially blocking calls.
+ *
+ *  Jobs are submitted from the event loop and their results are handed back
+ *  through a lock-free queue per worker, to be collected from the event loop
+ *  with poll(). The eventfd of the pool is readable while there are results
+ *  to collect, so the event loop can await them. The workers are detached,
+ *  so a call which never returns doesn't hold up the destruction of the pool
+ *  or the exit of the process.
+ *
+ *  When a job is submitted while all the workers are busy, another worker is
+ *  started, up to the maximum, so jobs blocked on a call which doesn't return
+ *  don't hold up the jobs queued behind them. Submitting at most one job per
+ *  resource at a time, e.g. per mount, bounds the workers it can block.
+ */
+template <typename Result, size_t Capacity = 64>
+class WorkerPool
+{
+  public:
+    using job_t = std::function<Result()>;
+
+    WorkerPool() = delete;
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    explicit WorkerPool(size_t threads) : WorkerPool(threads, threads) {}
+
+    WorkerPool(size_t threads, size_t maxThreads) :
+        maxThreads(std::max(threads, maxThreads)),
+        state(std::make_shared<State>())
+    {
+        state->results.reserve(threads);
+        for (size_t i = 0; i < threads; i++)
+        {
+            start();
+        }
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard lock(state->mutex);
+            state->stop = true;
+        }
+        state->condition.notify_all();
+    }
+
+    /** @brief Queue a job to be run by one of the workers */
+    void submit(job_t job)
+    {
+        bool busy = false;
+        {
+            std::lock_guard lock(state->mutex);
+            state->jobs.emplace_back(std::move(job));
+            busy = state->jobs.size() > state->idle;
+        }
+        if (busy && state->results.size() < maxThreads)
+        {
+            start();
+        }
+        state->condition.notify_one();
+    }
+
+    /** @brief Get the number of workers started */
+    auto threads() const -> size_t
+    {
+        return state->results.size();
+    }
+
+    /** @brief Get the eventfd which is readable while there are results */
+    auto fd() const -> int
+    {
+        return state->event;
+    }
+
+    /** @brief Call the handler with the results of the completed jobs */
+    template <typename Handler>
+    void poll(Handler&& handler)
+    {
+        // Reset before popping, so a result pushed meanwhile signals again
+        uint64_t count = 0;
+        [[maybe_unused]] auto size = ::read(state->event, &count,
+                                            sizeof(count));
+        for (auto& results : state->results)
+        {
+            while (auto result = results->pop())
+            {
+                handler(*result);
+            }
+        }
+    }
+
+  private:
+    using queue_t = SpscQueue<Result, Capacity>;
+
+    /** @brief State shared with the workers, which may outlive the pool */
+    struct State
+    {
+        State() : event(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {}
+        State(const State&) = delete;
+        State& operator=(const State&) = delete;
+        ~State()
+        {
+            if (event >= 0)
+            {
+                close(event);
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<job_t> jobs;
+        std::atomic<bool> stop = false;
+        /** @brief Workers waiting for a job, or about to */
+        size_t idle = 0;
+        /** @brief Result queues of the workers, added by the event loop */
+        std::vector<std::unique_ptr<queue_t>> results;
+        /** @brief Signaled by the workers when they push a result */
+        int event;
+    };
+
+    /** @brief Start a worker with its result queue */
+    void start()
+    {
+        {
+            std::lock_guard lock(state->mutex);
+            state->idle++;
+        }
+        auto& results =
+            *state->results.emplace_back(std::make_unique<queue_t>());
+        std::thread([state = state, &results]() {
+            run(*state, results);
+        }).detach();
+    }
+
+    /** @brief Run the jobs of the pool in a worker */
+    static void run(State& state, queue_t& results)
+    {
+        while (true)
+        {
+            job_t job;
+            {
+                std::unique_lock lock(state.mutex);
+                state.condition.wait(
+                    lock, [&] { return state.stop || !state.jobs.empty(); });
+                if (state.stop)
+                {
+                    return;
+                }
+                job = std::move(state.jobs.front());
+                state.jobs.pop_front();
+                state.idle--;
+            }
+
+            auto result = job();
+            // The event loop drains the results every collection cycle
+            while (!results.push(std::move(result)))
+            {
+                if (state.stop)
+                {
+                    return;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            uint64_t one = 1;
+            [[maybe_unused]] auto size = ::write(state.event, &one,
+                                                 sizeof(one));
+
+            std::lock_guard lock(state.mutex);
+            state.idle++;
+        }
+    }
+
+    /** @brief Maximum number of workers */
+    size_t maxThreads;
+    std::shared_ptr<State> state;
+};
+
+} // namespace phosphor::health::worker
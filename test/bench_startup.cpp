@@ -0,0 +1,214 @@
+#include "health_batch_reader.hpp"
+#include "health_metric_collection.hpp"
+#include "health_metric_config.hpp"
+#include "synthetic_cgroups.hpp"
+
+#include <sdbusplus/test/sdbus_mock.hpp>
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+extern "C"
+{
+#include <time.h>
+#include <unistd.h>
+}
+
+#include <gmock/gmock.h>
+
+/*
+ * Startup benchmark: the config load, and the creation and announcement of N
+ * synthetic cgroup memory metrics on a mocked bus as the monitor does it at
+ * startup. The metrics are visible to the object mapper once announced, so
+ * the time to visible is estimated as the sum of the time from the process
+ * start to main, the config load and the creation and announcement of the
+ * metrics, which are measured separately. It is synthetic, no mapper is
+ * involved. It fails when a metric signals before it's announced, or isn't
+ * announced once.
+ */
+
+namespace ConfigIntf = phosphor::health::metric::config;
+namespace MetricIntf = phosphor::health::metric;
+namespace CollectionIntf = phosphor::health::metric::collection;
+namespace synthetic = phosphor::health::test::synthetic;
+
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+
+using std::chrono::duration_cast;
+using std::chrono::microseconds;
+using std::chrono::steady_clock;
+
+constexpr auto metricCounts = std::to_array<size_t>({10, 100, 1000, 2000});
+constexpr auto iterations = 100;
+
+/** @brief Get the time since the process started, from /proc/self/stat */
+static auto sinceProcessStart() -> microseconds
+{
+    std::ifstream stat("/proc/self/stat");
+    std::string line;
+    std::getline(stat, line);
+    // The command may contain spaces, the fields follow its closing paren
+    std::istringstream fields(line.substr(line.rfind(')') + 2));
+    std::string field;
+    // starttime is the 22nd field, the 20th after the command
+    for (auto i = 0; i < 20; i++)
+    {
+        fields >> field;
+    }
+    auto ticks = std::stoull(field);
+
+    timespec now{};
+    clock_gettime(CLOCK_BOOTTIME, &now);
+    auto start = microseconds(ticks * 1'000'000 / sysconf(_SC_CLK_TCK));
+    return std::chrono::seconds(now.tv_sec) +
+           duration_cast<microseconds>(std::chrono::nanoseconds(now.tv_nsec)) -
+           start;
+}
+
+struct Result
+{
+    size_t metrics = 0;
+    microseconds create{};
+    microseconds announce{};
+    /** @brief Signals emitted while the metrics were created */
+    size_t createSignals = 0;
+    /** @brief InterfacesAdded signals emitted by the announcement */
+    size_t objectsAdded = 0;
+};
+
+static auto run(const std::filesystem::path& slice, size_t count) -> Result
+{
+    NiceMock<sdbusplus::SdBusMock> sdbusMock;
+    auto bus = sdbusplus::get_mocked_new(&sdbusMock);
+
+    size_t signals = 0;
+    size_t objectsAdded = 0;
+    auto countSignal = [&](auto...) {
+        signals++;
+        return 0;
+    };
+    ON_CALL(sdbusMock, sd_bus_emit_properties_changed_strv(_, _, _, _))
+        .WillByDefault(Invoke(countSignal));
+    ON_CALL(sdbusMock, sd_bus_message_new_signal(_, _, _, _, _))
+        .WillByDefault(Invoke(countSignal));
+    ON_CALL(sdbusMock, sd_bus_emit_object_added(_, _))
+        .WillByDefault(Invoke([&](auto...) {
+            objectsAdded++;
+            return 0;
+        }));
+
+    ConfigIntf::HealthMetric::map_t configs;
+    auto& cgroupConfigs = configs[MetricIntf::Type::cgroup];
+    for (size_t i = 0; i < count; i++)
+    {
+        auto service = "synthetic" + std::to_string(i) + ".service";
+        synthetic::createService(slice, service, synthetic::limit / 2);
+        cgroupConfigs.emplace_back(synthetic::memoryConfig(slice, service));
+    }
+
+    phosphor::health::reader::BatchReader reader;
+    MetricIntf::paths_t bmcPaths;
+    std::vector<std::unique_ptr<CollectionIntf::HealthMetricCollection>>
+        collections;
+
+    auto start = steady_clock::now();
+    for (auto& [type, collectionConfigs] : configs)
+    {
+        collections.emplace_back(
+            std::make_unique<CollectionIntf::HealthMetricCollection>(
+                bus, type, collectionConfigs, bmcPaths, reader));
+    }
+    auto created = steady_clock::now();
+    auto createSignals = signals;
+    for (auto& collection : collections)
+    {
+        collection->announce();
+    }
+    auto announced = steady_clock::now();
+
+    collections.clear();
+    std::filesystem::remove_all(slice);
+    return {
+        .metrics = count,
+        .create = duration_cast<microseconds>(created - start),
+        .announce = duration_cast<microseconds>(announced - created),
+        .createSignals = createSignals,
+        .objectsAdded = objectsAdded,
+    };
+}
+
+int main()
+{
+    auto toMain = sinceProcessStart();
+    auto rssBefore = synthetic::statusKiB("VmRSS");
+
+    auto start = steady_clock::now();
+    auto configs = ConfigIntf::getHealthMetricConfigs();
+    auto firstLoad = duration_cast<microseconds>(steady_clock::now() - start);
+
+    start = steady_clock::now();
+    for (auto i = 0; i < iterations; i++)
+    {
+        configs = ConfigIntf::getHealthMetricConfigs();
+    }
+    auto loads = duration_cast<microseconds>(steady_clock::now() - start);
+
+    std::cout << "process_start_to_main_us " << toMain.count() << "\n"
+              << "config_first_load_us " << firstLoad.count() << "\n"
+              << "config_load_avg_us " << loads.count() / iterations << "\n"
+              << "config_types " << configs.size() << "\n"
+              << "rss_startup_kib " << rssBefore << "\n"
+              << "rss_loaded_kib " << synthetic::statusKiB("VmRSS")
+              << std::endl;
+
+    auto openFiles = synthetic::raiseOpenFiles();
+
+    auto slice = std::filesystem::temp_directory_path() /
+                 ("bench_startup_" + std::to_string(getpid()));
+
+    std::cout << "# visible_estimate_us is a synthetic estimate, the sum of "
+                 "the separately measured startup steps, not a measurement of "
+                 "the visibility in the object mapper"
+              << std::endl;
+
+    auto failed = false;
+    for (auto count : metricCounts)
+    {
+        if (!synthetic::fitOpenFiles(count, openFiles))
+        {
+            std::cout << "startup_" << count << "_skipped_open_files "
+                      << openFiles << "\n";
+            continue;
+        }
+        auto result = run(slice, count);
+        auto visible = toMain + firstLoad + result.create + result.announce;
+        std::cout << "startup_" << count << "_create_us "
+                  << result.create.count() << "\n"
+                  << "startup_" << count << "_announce_us "
+                  << result.announce.count() << "\n"
+                  << "startup_" << count << "_visible_estimate_us "
+                  << visible.count() << "\n"
+                  << "startup_" << count << "_create_signals "
+                  << result.createSignals << "\n"
+                  << "startup_" << count << "_objects_added "
+                  << result.objectsAdded << std::endl;
+
+        if (result.createSignals != 0 || result.objectsAdded != count)
+        {
+            std::cerr << "FAIL: metrics not announced once each with "
+                      << count << " metrics" << std::endl;
+            failed = true;
+        }
+    }
+
+    std::cout << "rss_peak_kib " << synthetic::statusKiB("VmHWM") << std::endl;
+    return failed ? 1 : 0;
+}
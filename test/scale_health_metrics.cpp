@@ -0,0 +1,246 @@
+#include "health_batch_reader.hpp"
+#include "health_metric_collection.hpp"
+#include "synthetic_cgroups.hpp"
+
+#include <sdbusplus/async.hpp>
+#include <sdbusplus/test/sdbus_mock.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+extern "C"
+{
+#include <unistd.h>
+}
+
+#include <gmock/gmock.h>
+
+/*
+ * Scale harness for the whole collection pipeline: N synthetic cgroup memory
+ * metrics are read by the batch reader from files with synthetic values, and
+ * published on a mocked bus, for M cycles. It reports the cycle latency, the
+ * RSS, in total and per metric, and the D-Bus messages as N grows, and fails
+ * when the RSS or the messages regress beyond the budgets below.
+ *
+ * The cycle latency depends on the machine and its load, so its budgets are
+ * only checked with --timing, which the meson benchmark target passes.
+ */
+
+namespace ConfigIntf = phosphor::health::metric::config;
+namespace MetricIntf = phosphor::health::metric;
+namespace CollectionIntf = phosphor::health::metric::collection;
+namespace synthetic = phosphor::health::test::synthetic;
+
+using ThresholdIntf =
+    sdbusplus::server::xyz::openbmc_project::common::Threshold;
+using ::testing::_;
+using ::testing::Invoke;
+using ::testing::NiceMock;
+
+constexpr auto metricCounts = std::to_array<size_t>({10, 100, 1000, 2000});
+constexpr auto cycles = 50;
+constexpr auto windowSize = 10;
+
+/** @brief Mean cycle time per metric, checked with --timing */
+constexpr auto maxCycleNsPerMetric = 100'000;
+/** @brief Smallest count the growth of the cycle time is measured from, as
+ *         the fixed cost of a cycle dominates smaller ones */
+constexpr auto growthBaseline = 100;
+/** @brief Growth of the cycle time per metric from the baseline, checked with
+ *         --timing. It stays flat when the cycle is linear in the metrics, so
+ *         the margin only allows for cache effects and noise. */
+constexpr auto maxCycleGrowth = 4.0;
+/** @brief RSS per metric */
+constexpr auto maxRssKiBPerMetric = 64;
+/** @brief D-Bus messages per metric per cycle: the metric value, and the
+ *         threshold value, asserted property and AssertionChanged signal */
+constexpr auto maxMessagesPerMetric = 4.0;
+
+/** @brief Synthetic memory usage of a service in a cycle, which moves past
+ *         the hysteresis and across the threshold */
+static auto syntheticValue(size_t service, int cycle) -> uint64_t
+{
+    auto load = 0.5 + 0.45 * std::sin(0.7 * cycle + service);
+    return static_cast<uint64_t>(synthetic::limit * load);
+}
+
+struct Result
+{
+    size_t metrics = 0;
+    double cycleNsPerMetric = 0;
+    double cycleMaxUs = 0;
+    long rssKiB = 0;
+    double messagesPerCycle = 0;
+
+    /** @brief RSS of the metrics, their collection and reader slots, per
+     *         metric */
+    auto rssBytesPerMetric() const -> double
+    {
+        return static_cast<double>(rssKiB) * 1024 / metrics;
+    }
+};
+
+static auto run(const std::filesystem::path& slice, size_t count) -> Result
+{
+    NiceMock<sdbusplus::SdBusMock> sdbusMock;
+    auto bus = sdbusplus::get_mocked_new(&sdbusMock);
+
+    size_t messages = 0;
+    auto countMessage = [&](auto...) {
+        messages++;
+        return 0;
+    };
+    ON_CALL(sdbusMock, sd_bus_emit_properties_changed_strv(_, _, _, _))
+        .WillByDefault(Invoke(countMessage));
+    ON_CALL(sdbusMock, sd_bus_message_new_signal(_, _, _, _, _))
+        .WillByDefault(Invoke(countMessage));
+
+    std::vector<std::string> services;
+    for (size_t i = 0; i < count; i++)
+    {
+        auto& service =
+            services.emplace_back("synthetic" + std::to_string(i) + ".service");
+        synthetic::createService(slice, service, syntheticValue(i, 0));
+    }
+
+    ConfigIntf::HealthMetric::map_t configs;
+    auto& cgroupConfigs = configs[MetricIntf::Type::cgroup];
+    for (const auto& service : services)
+    {
+        auto config = synthetic::memoryConfig(slice, service);
+        config.windowSize = windowSize;
+        config.thresholds.emplace(
+            std::make_tuple(ThresholdIntf::Type::Critical,
+                            ThresholdIntf::Bound::Upper),
+            ConfigIntf::Threshold{.value = 90.0});
+        cgroupConfigs.emplace_back(std::move(config));
+    }
+
+    auto rssBefore = synthetic::statusKiB("VmRSS");
+    phosphor::health::reader::BatchReader reader;
+    MetricIntf::paths_t bmcPaths;
+    std::vector<std::unique_ptr<CollectionIntf::HealthMetricCollection>>
+        collections;
+    for (auto& [type, collectionConfigs] : configs)
+    {
+        collections.emplace_back(
+            std::make_unique<CollectionIntf::HealthMetricCollection>(
+                bus, type, collectionConfigs, bmcPaths, reader));
+    }
+
+    using clock = std::chrono::steady_clock;
+    clock::duration total{};
+    clock::duration slowest{};
+    messages = 0;
+    // The collections are read on an event loop, as by the monitor. The
+    // coroutine is named, so its captures outlive the loop.
+    sdbusplus::async::context ctx;
+    auto run = [&]() -> sdbusplus::async::task<> {
+        for (auto cycle = 1; cycle <= cycles; cycle++)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                synthetic::writeUsage(slice, services[i],
+                                      syntheticValue(i, cycle));
+            }
+
+            auto start = clock::now();
+            co_await reader.read(ctx);
+            for (auto& collection : collections)
+            {
+                co_await collection->read(ctx);
+            }
+            auto elapsed = clock::now() - start;
+            total += elapsed;
+            slowest = std::max(slowest, elapsed);
+        }
+        ctx.request_stop();
+    };
+    ctx.spawn(run());
+    ctx.run();
+    auto rssAfter = synthetic::statusKiB("VmRSS");
+
+    std::filesystem::remove_all(slice);
+    return {
+        .metrics = count,
+        .cycleNsPerMetric =
+            std::chrono::duration<double, std::nano>(total).count() /
+            (cycles * count),
+        .cycleMaxUs =
+            std::chrono::duration<double, std::micro>(slowest).count(),
+        .rssKiB = rssAfter - rssBefore,
+        .messagesPerCycle = static_cast<double>(messages) / cycles,
+    };
+}
+
+int main(int argc, char** argv)
+{
+    auto timing = argc > 1 && std::string_view(argv[1]) == "--timing";
+
+    auto openFiles = synthetic::raiseOpenFiles();
+
+    auto slice = std::filesystem::temp_directory_path() /
+                 ("scale_health_metrics_" + std::to_string(getpid()));
+
+    std::vector<Result> results;
+    for (auto count : metricCounts)
+    {
+        if (!synthetic::fitOpenFiles(count, openFiles))
+        {
+            std::cout << "scale_" << count << "_skipped_open_files "
+                      << openFiles << "\n";
+            continue;
+        }
+        auto& result = results.emplace_back(run(slice, count));
+        std::cout << "scale_" << count << "_cycle_ns_per_metric "
+                  << result.cycleNsPerMetric << "\n"
+                  << "scale_" << count << "_cycle_max_us " << result.cycleMaxUs
+                  << "\n"
+                  << "scale_" << count << "_rss_kib " << result.rssKiB << "\n"
+                  << "scale_" << count << "_rss_bytes_per_metric "
+                  << result.rssBytesPerMetric() << "\n"
+                  << "scale_" << count << "_messages_per_cycle "
+                  << result.messagesPerCycle << std::endl;
+    }
+
+    auto failed = false;
+    auto check = [&](bool ok, const std::string& what, const Result& result) {
+        if (!ok)
+        {
+            std::cerr << "FAIL: " << what << " with " << result.metrics
+                      << " metrics" << std::endl;
+            failed = true;
+        }
+    };
+    auto baseline = std::ranges::find_if(results, [](const auto& result) {
+        return result.metrics >= growthBaseline;
+    });
+    for (const auto& result : results)
+    {
+        check(result.rssBytesPerMetric() <= maxRssKiBPerMetric * 1024,
+              "RSS per metric", result);
+        check(result.messagesPerCycle <=
+                  maxMessagesPerMetric * result.metrics,
+              "D-Bus messages per metric", result);
+        if (!timing)
+        {
+            continue;
+        }
+        check(result.cycleNsPerMetric <= maxCycleNsPerMetric,
+              "cycle time per metric", result);
+        if (baseline != results.end() && result.metrics > baseline->metrics)
+        {
+            check(result.cycleNsPerMetric <=
+                      maxCycleGrowth * baseline->cycleNsPerMetric,
+                  "growth of the cycle time per metric", result);
+        }
+    }
+    return failed ? 1 : 0;
+}
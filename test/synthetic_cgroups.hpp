@@ -0,0 +1,91 @@
+#pragma once
+
+#include "health_metric_config.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+extern "C"
+{
+#include <sys/resource.h>
+}
+
+/*
+ * Fixture of the benchmarks: a slice of synthetic services in a temporary
+ * directory, with the cgroup memory files of each, and the cgroup memory
+ * metrics which read them.
+ */
+
+namespace phosphor::health::test::synthetic
+{
+
+namespace ConfigIntf = phosphor::health::metric::config;
+namespace MetricIntf = phosphor::health::metric;
+
+/** @brief Memory limit of the synthetic services */
+constexpr uint64_t limit = 1 << 30;
+
+/** @brief Get a memory figure in kB from /proc/self/status */
+inline auto statusKiB(const std::string& field) -> long
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.starts_with(field + ":"))
+        {
+            return std::stol(line.substr(field.size() + 1));
+        }
+    }
+    return -1;
+}
+
+/** @brief Raise the open files limit to the hard limit, and get it */
+inline auto raiseOpenFiles() -> rlim_t
+{
+    rlimit files{};
+    getrlimit(RLIMIT_NOFILE, &files);
+    files.rlim_cur = files.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &files);
+    return files.rlim_cur;
+}
+
+/** @brief Whether the metrics fit in the open files limit, as each metric
+ *         keeps two cgroup files open */
+inline auto fitOpenFiles(size_t metrics, rlim_t openFiles) -> bool
+{
+    return 2 * metrics + 64 <= openFiles;
+}
+
+/** @brief Set the memory usage of a synthetic service */
+inline void writeUsage(const std::filesystem::path& slice,
+                       const std::string& service, uint64_t usage)
+{
+    std::ofstream(slice / service / "memory.current") << usage;
+}
+
+/** @brief Create a synthetic service in the slice, with its memory usage */
+inline void createService(const std::filesystem::path& slice,
+                          const std::string& service, uint64_t usage)
+{
+    std::filesystem::create_directories(slice / service);
+    std::ofstream(slice / service / "memory.max") << limit;
+    writeUsage(slice, service, usage);
+}
+
+/** @brief Get the config of the memory metric of a synthetic service */
+inline auto memoryConfig(const std::filesystem::path& slice,
+                         const std::string& service)
+    -> ConfigIntf::HealthMetric
+{
+    ConfigIntf::HealthMetric config;
+    config.name = "Cgroup_Memory";
+    config.subType = MetricIntf::SubType::cgroupMemory;
+    config.path = slice;
+    config.services = {service};
+    return config;
+}
+
+} // namespace phosphor::health::test::synthetic
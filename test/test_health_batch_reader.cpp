@@ -0,0 +1,168 @@
+#include "health_batch_reader.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+extern "C"
+{
+#include <unistd.h>
+}
+
+#include <gtest/gtest.h>
+
+using phosphor::health::reader::BatchReader;
+
+class BatchReaderTest : public ::testing::Test
+{
+  public:
+    std::filesystem::path directory;
+
+    void SetUp() override
+    {
+        directory = std::filesystem::temp_directory_path() /
+                    ("batch_reader_" + std::to_string(getpid()));
+        std::filesystem::create_directories(directory);
+    }
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(directory);
+    }
+
+    auto write(const std::string& name, const std::string& content)
+        -> std::string
+    {
+        auto path = directory / name;
+        std::ofstream(path) << content;
+        return path;
+    }
+};
+
+TEST_F(BatchReaderTest, TestReadBatch)
+{
+    BatchReader reader;
+    auto first = reader.add(write("first", "first content"));
+    auto second = reader.add(write("second", "second"));
+    auto missing = reader.add(directory / "missing");
+
+    reader.read();
+    EXPECT_EQ(reader.get(first), "first content");
+    EXPECT_EQ(reader.get(second), "second");
+    EXPECT_EQ(reader.get(missing), std::nullopt);
+}
+
+TEST_F(BatchReaderTest, TestReadOnce)
+{
+    BatchReader reader;
+    auto first = reader.add(write("first", "1"));
+    auto second = reader.add(write("second", "2"));
+    // The same file is only read once
+    EXPECT_EQ(reader.add(directory / "first"), first);
+
+    // Getting an added file reads only that file
+    EXPECT_EQ(reader.get(first), "1");
+    write("first", "10");
+    write("second", "20");
+    EXPECT_EQ(reader.get(first), "1");
+    EXPECT_EQ(reader.get(second), "20");
+    EXPECT_EQ(reader.get(first), "1");
+
+    reader.read();
+    EXPECT_EQ(reader.get(first), "10");
+    EXPECT_EQ(reader.get(second), "20");
+}
+
+TEST_F(BatchReaderTest, TestTruncatedToBufferSize)
+{
+    BatchReader reader;
+    auto slot = reader.add(write("file", "0123456789"), 4);
+    EXPECT_EQ(reader.get(slot), "0123");
+}
+
+TEST_F(BatchReaderTest, TestReopen)
+{
+    BatchReader reader;
+    auto path = directory / "file";
+    auto slot = reader.add(path);
+    EXPECT_EQ(reader.get(slot), std::nullopt);
+
+    write("file", "created");
+    EXPECT_TRUE(reader.reopen(slot));
+    EXPECT_EQ(reader.get(slot), "created");
+
+    // A recreated file needs to be reopened
+    std::filesystem::remove(path);
+    write("file", "recreated");
+    reader.read();
+    EXPECT_EQ(reader.get(slot), "created");
+    EXPECT_TRUE(reader.reopen(slot));
+    EXPECT_EQ(reader.get(slot), "recreated");
+}
+
+TEST_F(BatchReaderTest, TestReopenPath)
+{
+    BatchReader reader;
+    auto slot = reader.add(write("first", "first"));
+    EXPECT_EQ(reader.get(slot), "first");
+
+    EXPECT_TRUE(reader.reopen(slot, write("second", "second")));
+    EXPECT_EQ(reader.get(slot), "second");
+    // The slot is found by its new path
+    EXPECT_EQ(reader.add(directory / "second"), slot);
+}
+
+TEST_F(BatchReaderTest, TestParseOncePerBatch)
+{
+    BatchReader reader;
+    auto path = write("stat", "1");
+    auto slot = reader.add(path);
+    auto parses = 0;
+    auto parser = [&parses](std::string_view content) {
+        parses++;
+        return std::string(content);
+    };
+
+    reader.read();
+    // Shared by the collections reading the same file in a cycle
+    EXPECT_EQ(*reader.parse(slot, parser), "1");
+    EXPECT_EQ(*reader.parse(slot, parser), "1");
+    EXPECT_EQ(parses, 1);
+
+    // Parsed again with the next batch
+    std::ofstream(path) << "2";
+    reader.read();
+    EXPECT_EQ(*reader.parse(slot, parser), "2");
+    EXPECT_EQ(parses, 2);
+
+    auto missing = reader.add(directory / "missing");
+    EXPECT_EQ(reader.parse(missing, parser), nullptr);
+}
+
+TEST_F(BatchReaderTest, TestReadOnEventLoop)
+{
+    BatchReader reader;
+    std::vector<BatchReader::slot_t> slots;
+    // More files than the entries of the ring
+    for (auto i = 0; i < 100; i++)
+    {
+        auto name = std::to_string(i);
+        slots.push_back(reader.add(write(name, name)));
+    }
+    auto missing = reader.add(directory / "missing");
+
+    sdbusplus::async::context ctx;
+    auto read = [&]() -> sdbusplus::async::task<> {
+        co_await reader.read(ctx);
+        ctx.request_stop();
+    };
+    ctx.spawn(read());
+    ctx.run();
+
+    for (auto i = 0; i < 100; i++)
+    {
+        EXPECT_EQ(reader.get(slots[i]), std::to_string(i));
+    }
+    EXPECT_EQ(reader.get(missing), std::nullopt);
+}
@@ -0,0 +1,173 @@
+#include "health_exporter.hpp"
+
+#include <sdbusplus/async.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <string>
+#include <thread>
+
+extern "C"
+{
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+}
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace phosphor::health::exporter;
+using namespace std::chrono_literals;
+using ::testing::EndsWith;
+using ::testing::HasSubstr;
+using ::testing::Not;
+
+TEST(ExpositionTest, TestFamiliesAndEOF)
+{
+    Exposition exposition;
+    auto content = std::string(exposition.content());
+    EXPECT_THAT(content, HasSubstr("# TYPE bmc_health_metric gauge\n"));
+    EXPECT_THAT(content,
+                HasSubstr("# TYPE bmc_health_threshold_asserted gauge\n"));
+    EXPECT_THAT(content, EndsWith("# EOF\n"));
+}
+
+TEST(ExpositionTest, TestSeriesPublished)
+{
+    Exposition exposition;
+    auto& value = exposition.add(Family::value);
+    auto& asserted = exposition.add(Family::asserted);
+
+    appendSample(value.buffer(), Family::value, "metric=\"CPU\"", 12.5);
+    value.publish();
+    appendSample(asserted.buffer(), Family::asserted,
+                 "metric=\"CPU\",threshold=\"Critical_Upper\"", 1);
+    asserted.publish();
+
+    auto content = std::string(exposition.content());
+    EXPECT_THAT(content, HasSubstr("bmc_health_metric{metric=\"CPU\"} 12.5\n"));
+    EXPECT_THAT(content, HasSubstr("bmc_health_threshold_asserted{metric="
+                                   "\"CPU\",threshold=\"Critical_Upper\"} 1\n"));
+    // Samples are grouped under their family
+    EXPECT_LT(content.find("# TYPE bmc_health_metric gauge"),
+              content.find("bmc_health_metric{"));
+    EXPECT_LT(content.find("bmc_health_metric{"),
+              content.find("# TYPE bmc_health_window gauge"));
+}
+
+TEST(ExpositionTest, TestSeriesUpdated)
+{
+    Exposition exposition;
+    auto& value = exposition.add(Family::value);
+    appendSample(value.buffer(), Family::value, "metric=\"CPU\"", 1);
+    value.publish();
+    auto first = exposition.content();
+    EXPECT_THAT(std::string(first), HasSubstr("{metric=\"CPU\"} 1\n"));
+
+    // Unchanged lines don't rebuild the exposition
+    appendSample(value.buffer(), Family::value, "metric=\"CPU\"", 1);
+    value.publish();
+    EXPECT_EQ(exposition.content().data(), first.data());
+
+    appendSample(value.buffer(), Family::value, "metric=\"CPU\"", 2);
+    value.publish();
+    auto content = std::string(exposition.content());
+    EXPECT_THAT(content, HasSubstr("{metric=\"CPU\"} 2\n"));
+    EXPECT_THAT(content, Not(HasSubstr("{metric=\"CPU\"} 1\n")));
+}
+
+TEST(ExpositionTest, TestSpecialValues)
+{
+    std::string buffer;
+    appendSample(buffer, Family::window, "metric=\"A\"",
+                 std::numeric_limits<double>::quiet_NaN());
+    appendSample(buffer, Family::window, "metric=\"B\"",
+                 std::numeric_limits<double>::infinity());
+    appendSample(buffer, Family::window, "metric=\"C\"",
+                 -std::numeric_limits<double>::infinity());
+    EXPECT_EQ(buffer, "bmc_health_window{metric=\"A\"} NaN\n"
+                      "bmc_health_window{metric=\"B\"} +Inf\n"
+                      "bmc_health_window{metric=\"C\"} -Inf\n");
+}
+
+TEST(ExpositionTest, TestEscapeLabel)
+{
+    EXPECT_EQ(escapeLabel("Storage_Mounts_/run/media/usb"),
+              "Storage_Mounts_/run/media/usb");
+    EXPECT_EQ(escapeLabel("a\\b\"c\nd"), "a\\\\b\\\"c\\nd");
+}
+
+/** @brief Connect a blocking client to the socket */
+static auto connectClient(const std::string& path) -> FileDescriptor
+{
+    FileDescriptor client(socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    EXPECT_EQ(connect(client.get(), reinterpret_cast<sockaddr*>(&address),
+                      sizeof(address)),
+              0);
+    return client;
+}
+
+/** @brief Read from the client until end of file */
+static auto readAll(const FileDescriptor& client) -> std::string
+{
+    std::string content;
+    char buffer[65536];
+    ssize_t size = 0;
+    while ((size = read(client.get(), buffer, sizeof(buffer))) > 0)
+    {
+        content.append(buffer, size);
+    }
+    return content;
+}
+
+TEST(ExporterTest, TestStalledClient)
+{
+    auto path = std::filesystem::temp_directory_path() /
+                ("exporter_" + std::to_string(getpid()) + ".sock");
+    sdbusplus::async::context ctx;
+    Exporter exporter(ctx, path);
+
+    // An exposition much larger than the socket buffers
+    auto& series = exporter.exposition().add(Family::value);
+    auto& buffer = series.buffer();
+    for (auto i = 0; i < 100000; i++)
+    {
+        appendSample(buffer, Family::value,
+                     "metric=\"M" + std::to_string(i) + "\"", i);
+    }
+    series.publish();
+    auto expected = std::string(exporter.exposition().content());
+
+    // A client which doesn't read doesn't hold up the others
+    auto stalled = connectClient(path);
+    std::string received;
+    std::atomic<bool> done = false;
+    std::thread reader([&] {
+        received = readAll(connectClient(path));
+        done = true;
+    });
+
+    auto run = [&]() -> sdbusplus::async::task<> {
+        for (auto i = 0; i < 500 && !done; i++)
+        {
+            co_await sdbusplus::async::sleep_for(ctx, 10ms);
+        }
+        // Until it is dropped after the send timeout
+        co_await sdbusplus::async::sleep_for(ctx, 1500ms);
+        ctx.request_stop();
+    };
+    ctx.spawn(run());
+    ctx.run();
+    reader.join();
+
+    EXPECT_EQ(received, expected);
+    EXPECT_LT(readAll(stalled).size(), expected.size());
+    std::filesystem::remove(path);
+}
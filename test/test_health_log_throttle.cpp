@@ -0,0 +1,55 @@
+#include "health_log_throttle.hpp"
+
+#include <chrono>
+#include <string>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace phosphor::health::throttle;
+using namespace std::chrono_literals;
+using ::testing::HasSubstr;
+
+TEST(LogThrottleTest, TestRepeatsSuppressed)
+{
+    LogThrottle throttle(10min);
+    auto now = LogThrottle::clock::now();
+
+    EXPECT_TRUE(throttle.admit("statvfs /mnt", now));
+    EXPECT_FALSE(throttle.admit("statvfs /mnt", now + 1s));
+    EXPECT_FALSE(throttle.admit("statvfs /mnt", now + 2s));
+    // Other keys are throttled on their own
+    EXPECT_TRUE(throttle.admit("statvfs /tmp", now + 2s));
+    EXPECT_EQ(throttle.suppressed(), 2);
+
+    // Logged again once the interval elapsed
+    EXPECT_TRUE(throttle.admit("statvfs /mnt", now + 10min + 1s));
+    EXPECT_FALSE(throttle.admit("statvfs /mnt", now + 10min + 2s));
+    EXPECT_EQ(throttle.suppressed(), 3);
+}
+
+TEST(LogThrottleTest, TestClear)
+{
+    LogThrottle throttle(10min);
+    auto now = LogThrottle::clock::now();
+
+    EXPECT_TRUE(throttle.admit("collect CPU", now));
+    EXPECT_FALSE(throttle.admit("collect CPU", now + 1s));
+    // The error went away, so it is logged as soon as it comes back
+    throttle.clear("collect CPU");
+    EXPECT_TRUE(throttle.admit("collect CPU", now + 2s));
+}
+
+TEST(LogThrottleTest, TestExport)
+{
+    phosphor::health::exporter::Exposition exposition;
+    LogThrottle throttle(10min);
+    throttle.exportTo(exposition);
+    EXPECT_THAT(std::string(exposition.content()),
+                HasSubstr("\nbmc_health_log_suppressed 0\n"));
+
+    throttle.admit("collect CPU");
+    throttle.admit("collect CPU");
+    EXPECT_THAT(std::string(exposition.content()),
+                HasSubstr("\nbmc_health_log_suppressed 1\n"));
+}
@@ -3,6 +3,10 @@
 #include <sdbusplus/test/sdbus_mock.hpp>
 #include <xyz/openbmc_project/Metric/Value/server.hpp>
 
+#include <chrono>
+#include <cmath>
+#include <string>
+
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
@@ -52,6 +56,7 @@ TEST_F(HealthMetricTest, TestMetricUnmockedObjectAddRemove)
     unmockedBus.request_name(busName);
     auto metric = std::make_unique<HealthMetric>(unmockedBus, Type::cpu, config,
                                                  paths_t());
+    metric->announce();
 }
 
 TEST_F(HealthMetricTest, TestMetricThresholdChange)
@@ -93,3 +98,207 @@ TEST_F(HealthMetricTest, TestMetricThresholdChange)
     // Go below warning threshold
     metric->update(MValue(1199, 1500));
 }
+
+TEST_F(HealthMetricTest, TestShutdownThresholdSubWindow)
+{
+    config.windowSize = 10;
+    config.thresholds = {
+        {{ThresholdIntf::Type::HardShutdown, ThresholdIntf::Bound::Upper},
+         {.value = 95.0, .log = false, .target = "", .windowSize = 1}},
+        {{ThresholdIntf::Type::SoftShutdown, ThresholdIntf::Bound::Upper},
+         {.value = 90.0, .log = false, .target = "", .windowSize = 2}},
+        {{ThresholdIntf::Type::Critical, ThresholdIntf::Bound::Upper},
+         {.value = 80.0, .log = false, .target = ""}}};
+
+    // Hard shutdown asserted and deasserted, soft shutdown asserted
+    EXPECT_CALL(sdbusMock,
+                sd_bus_message_new_signal(_, _, StrEq(objPath),
+                                          StrEq(ThresholdIntf::interface),
+                                          StrEq("AssertionChanged")))
+        .Times(3);
+
+    auto metric =
+        std::make_unique<HealthMetric>(bus, Type::cpu, config, paths_t());
+    // The latest sample crosses the hard shutdown threshold right away
+    metric->update(MValue(96, 100));
+    EXPECT_TRUE(metric->ThresholdIntf::asserted().contains(
+        {ThresholdIntf::Type::HardShutdown, ThresholdIntf::Bound::Upper}));
+    // The mean of the last two samples crosses the soft shutdown threshold
+    metric->update(MValue(92, 100));
+    auto asserted = metric->ThresholdIntf::asserted();
+    EXPECT_FALSE(asserted.contains(
+        {ThresholdIntf::Type::HardShutdown, ThresholdIntf::Bound::Upper}));
+    EXPECT_TRUE(asserted.contains(
+        {ThresholdIntf::Type::SoftShutdown, ThresholdIntf::Bound::Upper}));
+    // The critical threshold waits for the window to fill
+    EXPECT_FALSE(asserted.contains(
+        {ThresholdIntf::Type::Critical, ThresholdIntf::Bound::Upper}));
+}
+
+TEST_F(HealthMetricTest, TestHistogramInterface)
+{
+    EXPECT_CALL(sdbusMock,
+                sd_bus_add_object_vtable(_, _, StrEq(objPath),
+                                         StrEq(HistogramIntf::interface),
+                                         NotNull(), NotNull()))
+        .Times(0);
+    auto metric =
+        std::make_unique<HealthMetric>(bus, Type::cpu, config, paths_t());
+    metric.reset();
+
+    // Only registered when configured
+    config.histogramPrecision = 4;
+    EXPECT_CALL(sdbusMock,
+                sd_bus_add_object_vtable(_, _, StrEq(objPath),
+                                         StrEq(HistogramIntf::interface),
+                                         NotNull(), NotNull()))
+        .Times(1);
+    metric = std::make_unique<HealthMetric>(bus, Type::cpu, config, paths_t());
+    metric->update(MValue(50, 100));
+}
+
+TEST_F(HealthMetricTest, TestValueSignalVolume)
+{
+    size_t signals = 0;
+    EXPECT_CALL(sdbusMock, sd_bus_emit_properties_changed_strv(
+                               _, StrEq(objPath), StrEq(ValueIntf::interface),
+                               NotNull()))
+        .WillRepeatedly(Invoke(
+            [&]([[maybe_unused]] sd_bus* bus, [[maybe_unused]] const char* path,
+                [[maybe_unused]] const char* interface, const char** names) {
+                signals += (std::string(names[0]) == "Value");
+                return 0;
+            }));
+
+    // Noisy kernel CPU usage near zero, sampled every second for a minute
+    auto countSignals = [&](const ConfigIntf::HealthMetric& config) {
+        signals = 0;
+        auto metric =
+            std::make_unique<HealthMetric>(bus, Type::cpu, config, paths_t());
+        auto start = std::chrono::steady_clock::now();
+        for (auto i = 0; i < 60; i++)
+        {
+            metric->update(MValue(0.5 + 0.4 * std::sin(i), 100,
+                                  start + std::chrono::seconds(i)));
+        }
+        return signals;
+    };
+    config.thresholds = {};
+
+    // Relative changes of a value near zero are signaled on every tick
+    EXPECT_EQ(countSignals(config), 60);
+
+    // Only the first value, the noise is within the absolute hysteresis
+    config.hysteresisAbsolute = 1.0;
+    EXPECT_EQ(countSignals(config), 1);
+
+    // Changed values are still signaled after the maximum interval
+    config.maxPublishInterval = std::chrono::seconds(15);
+    EXPECT_EQ(countSignals(config), 4);
+
+    // At most one signal per minimum interval
+    config.hysteresisAbsolute = 0;
+    config.maxPublishInterval = std::chrono::seconds(0);
+    config.minPublishInterval = std::chrono::seconds(10);
+    EXPECT_EQ(countSignals(config), 6);
+}
+
+TEST_F(HealthMetricTest, TestMetricAssociationsUpdate)
+{
+    sdbusplus::server::manager_t objManager(bus, objPath.c_str());
+    bus.request_name(busName);
+
+    auto metric =
+        std::make_unique<HealthMetric>(bus, Type::cpu, config, paths_t());
+
+    EXPECT_CALL(sdbusMock, sd_bus_emit_properties_changed_strv(
+                               IsNull(), StrEq(objPath),
+                               StrEq(AssociationIntf::interface), NotNull()))
+        .WillOnce(Invoke(
+            [&]([[maybe_unused]] sd_bus* bus, [[maybe_unused]] const char* path,
+                [[maybe_unused]] const char* interface, const char** names) {
+                EXPECT_STREQ("Associations", names[0]);
+                return 0;
+            }));
+
+    metric->updateAssociations({"/xyz/openbmc_project/inventory/bmc"});
+    EXPECT_THAT(metric->associations(), testing::SizeIs(1));
+}
+
+TEST_F(HealthMetricTest, TestCgroupMetricPath)
+{
+    const std::string cgroupPath = std::string(PathIntf::value) +
+                                   "/bmc/service/bmcweb_2eservice/memory";
+    config.name = "Cgroup_Memory_bmcweb.service";
+    config.subType = SubType::cgroupMemory;
+    config.path = "/sys/fs/cgroup/system.slice/bmcweb.service";
+
+    // The object is only announced once the others are created too
+    EXPECT_CALL(sdbusMock, sd_bus_emit_object_added(_, _)).Times(0);
+    EXPECT_CALL(sdbusMock, sd_bus_emit_properties_changed_strv(_, _, _, _))
+        .Times(0);
+
+    auto metric =
+        std::make_unique<HealthMetric>(bus, Type::cgroup, config, paths_t());
+    EXPECT_EQ(metric->ValueIntf::unit(), ValueIntf::Unit::Bytes);
+    testing::Mock::VerifyAndClearExpectations(&sdbusMock);
+
+    EXPECT_CALL(sdbusMock,
+                sd_bus_emit_object_added(IsNull(), StrEq(cgroupPath)))
+        .Times(1);
+    metric->announce();
+}
+
+TEST_F(HealthMetricTest, TestTimeToExhaustion)
+{
+    const std::string storagePath =
+        std::string(PathIntf::value) + "/bmc/" + PathIntf::storage + "/rw";
+    const std::string exhaustionPath = storagePath + "/time_to_exhaustion";
+    config.name = "Storage_RW";
+    config.subType = SubType::NA;
+    config.windowSize = 3;
+    config.thresholds = {};
+    config.timeToExhaustion = {.value = 1000000.0, .log = false, .target = ""};
+
+    EXPECT_CALL(sdbusMock,
+                sd_bus_emit_object_added(IsNull(), StrEq(exhaustionPath)))
+        .Times(1);
+    EXPECT_CALL(sdbusMock,
+                sd_bus_message_new_signal(_, _, StrEq(exhaustionPath),
+                                          StrEq(ThresholdIntf::interface),
+                                          StrEq("AssertionChanged")))
+        .Times(1);
+
+    auto metric =
+        std::make_unique<HealthMetric>(bus, Type::storage, config, paths_t());
+    metric->announce();
+    // Free space running out by 10 bytes per second
+    auto start = std::chrono::steady_clock::now();
+    metric->update(MValue(100, 1000, start));
+    metric->update(MValue(90, 1000, start + std::chrono::seconds(1)));
+    metric->update(MValue(80, 1000, start + std::chrono::seconds(2)));
+}
+
+TEST_F(HealthMetricTest, TestOpenMetricsExport)
+{
+    using ::testing::HasSubstr;
+    phosphor::health::exporter::Exposition exposition;
+    auto metric =
+        std::make_unique<HealthMetric>(bus, Type::cpu, config, paths_t());
+    metric->exportTo(exposition);
+
+    auto content = std::string(exposition.content());
+    EXPECT_THAT(content, HasSubstr("bmc_health_metric{metric=\"CPU_Kernel\","
+                                   "type=\"CPU\"} NaN\n"));
+
+    metric->update(MValue(95, 100));
+    content = std::string(exposition.content());
+    EXPECT_THAT(content, HasSubstr("bmc_health_metric{metric=\"CPU_Kernel\","
+                                   "type=\"CPU\"} 95\n"));
+    EXPECT_THAT(content,
+                HasSubstr("bmc_health_threshold_asserted{metric=\"CPU_Kernel\","
+                          "type=\"CPU\",threshold=\"Critical_Upper\"} 1\n"));
+    EXPECT_THAT(content,
+                HasSubstr("bmc_health_threshold_asserted{metric=\"CPU_Kernel\","
+                          "type=\"CPU\",threshold=\"Warning_Upper\"} 1\n"));
+}
@@ -0,0 +1,276 @@
+#include "health_metric_aggregator.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <memory_resource>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace ConfigIntf = phosphor::health::metric::config;
+using namespace phosphor::health::metric;
+using namespace phosphor::health::metric::aggregator;
+
+/** @brief Feed the samples through a window of the given size */
+static auto addSamples(Aggregator& aggregator, size_t windowSize,
+                       const std::vector<double>& samples)
+    -> std::vector<double>
+{
+    std::deque<double> window;
+    std::vector<double> values;
+    for (auto sample : samples)
+    {
+        std::optional<double> evicted;
+        if (window.size() >= windowSize)
+        {
+            evicted = window.front();
+            window.pop_front();
+        }
+        window.push_back(sample);
+        aggregator.add(sample, evicted);
+        values.push_back(aggregator.value());
+    }
+    return values;
+}
+
+TEST(HealthMetricAggregatorTest, TestMean)
+{
+    Mean mean;
+    auto values = addSamples(mean, 3, {3, 6, 9, 12, 0});
+    EXPECT_EQ(values, (std::vector<double>{3, 4.5, 6, 9, 7}));
+}
+
+TEST(HealthMetricAggregatorTest, TestEWMA)
+{
+    EWMA ewma(3);
+    auto values = addSamples(ewma, 3, {4, 8, 8});
+    EXPECT_EQ(values, (std::vector<double>{4, 6, 7}));
+}
+
+TEST(HealthMetricAggregatorTest, TestMax)
+{
+    Max max(3);
+    auto values = addSamples(max, 3, {1, 5, 2, 3, 1, 0, 0});
+    EXPECT_EQ(values, (std::vector<double>{1, 5, 5, 5, 3, 3, 1}));
+}
+
+TEST(HealthMetricAggregatorTest, TestMin)
+{
+    Min min(2);
+    auto values = addSamples(min, 2, {3, 1, 2, 4});
+    EXPECT_EQ(values, (std::vector<double>{3, 1, 1, 2}));
+}
+
+TEST(HealthMetricAggregatorTest, TestPercentile)
+{
+    constexpr auto windowSize = 1000;
+    std::mt19937 generator(1);
+    std::uniform_real_distribution<double> distribution(0.0, 100.0);
+    std::vector<double> samples(windowSize);
+    std::ranges::generate(samples, [&] { return distribution(generator); });
+
+    Percentile percentile(windowSize, 95.0);
+    auto values = addSamples(percentile, windowSize, samples);
+    EXPECT_NEAR(values.back(), 95.0, 2.0);
+}
+
+TEST(HealthMetricAggregatorTest, TestCreate)
+{
+    ConfigIntf::HealthMetric config;
+    config.aggregation = Aggregation::max;
+    auto max = create(config);
+    max->add(1, std::nullopt);
+    max->add(3, std::nullopt);
+    max->add(2, std::nullopt);
+    EXPECT_EQ(max->value(), 3);
+}
+
+/** @brief Feed the samples at the given times, in seconds, through a trend
+ *         with a window of the given size */
+static void addSamples(Trend& trend, size_t windowSize,
+                       std::chrono::steady_clock::time_point start,
+                       const std::vector<std::pair<double, double>>& samples)
+{
+    std::deque<Sample> window;
+    for (auto [seconds, value] : samples)
+    {
+        Sample sample{.timestamp = start + std::chrono::duration_cast<
+                                               std::chrono::nanoseconds>(
+                                               std::chrono::duration<double>(
+                                                   seconds)),
+                      .value = value};
+        std::optional<Sample> evicted;
+        if (window.size() >= windowSize)
+        {
+            evicted = window.front();
+            window.pop_front();
+        }
+        window.push_back(sample);
+        trend.add(sample, evicted);
+    }
+}
+
+TEST(HealthMetricAggregatorTest, TestTrend)
+{
+    const auto start = std::chrono::steady_clock::time_point{};
+    Trend trend;
+    // Steady decrease of 10 per second, after an initial jump
+    addSamples(trend, 4, start,
+               {{0, 500}, {1, 100}, {2, 90}, {3, 80}, {4, 70}, {5, 60}});
+    EXPECT_DOUBLE_EQ(trend.slope(), -10.0);
+    EXPECT_DOUBLE_EQ(trend.fitted(), 60.0);
+    EXPECT_DOUBLE_EQ(trend.secondsToZero(), 6.0);
+
+    Trend increasing;
+    addSamples(increasing, 4, start, {{0, 10}, {1, 20}});
+    EXPECT_EQ(increasing.secondsToZero(),
+              std::numeric_limits<double>::infinity());
+}
+
+TEST(HealthMetricAggregatorTest, TestTrendUnevenSamples)
+{
+    // A late sample doesn't skew the slope, after a long uptime
+    const auto start = std::chrono::steady_clock::time_point{} +
+                       std::chrono::hours(24 * 365);
+    Trend trend;
+    addSamples(trend, 3, start,
+               {{0, 100}, {1, 98}, {4, 92}, {5, 90}, {7.5, 85}});
+    EXPECT_NEAR(trend.slope(), -2.0, 1e-9);
+    EXPECT_NEAR(trend.fitted(), 85.0, 1e-9);
+    EXPECT_NEAR(trend.secondsToZero(), 42.5, 1e-9);
+}
+
+TEST(HealthMetricAggregatorTest, TestMeanNonFinite)
+{
+    Mean mean;
+    auto values = addSamples(
+        mean, 1, {std::numeric_limits<double>::infinity(), 10, 20});
+    EXPECT_EQ(values.back(), 20);
+}
+
+TEST(HealthMetricAggregatorTest, TestMeanRecoversFromNaN)
+{
+    constexpr auto nan = std::numeric_limits<double>::quiet_NaN();
+    Mean mean;
+    auto values = addSamples(mean, 3, {3, nan, 6, 9, 12});
+    EXPECT_EQ(values, (std::vector<double>{3, 3, 4.5, 7.5, 9}));
+
+    // A window of only non-finite samples has no mean
+    Mean empty;
+    EXPECT_TRUE(std::isnan(addSamples(empty, 2, {nan, nan}).back()));
+}
+
+TEST(HealthMetricAggregatorTest, TestEWMASkipsNaN)
+{
+    constexpr auto nan = std::numeric_limits<double>::quiet_NaN();
+    EWMA ewma(3);
+    auto values = addSamples(ewma, 3, {nan, 4, nan, 8, 8});
+    EXPECT_TRUE(std::isnan(values.front()));
+    EXPECT_EQ(std::vector<double>(values.begin() + 1, values.end()),
+              (std::vector<double>{4, 4, 6, 7}));
+}
+
+TEST(HealthMetricAggregatorTest, TestHistogram)
+{
+    Histogram histogram(5);
+    EXPECT_TRUE(std::isnan(histogram.percentile(50)));
+    EXPECT_TRUE(std::isnan(histogram.max()));
+
+    for (auto value = 1; value <= 1000; value++)
+    {
+        histogram.record(value);
+    }
+    EXPECT_EQ(histogram.count(), 1000);
+    EXPECT_EQ(histogram.max(), 1000);
+    // Within the relative error of the precision
+    EXPECT_NEAR(histogram.percentile(50), 500, 500.0 / 32);
+    EXPECT_NEAR(histogram.percentile(90), 900, 900.0 / 32);
+    EXPECT_NEAR(histogram.percentile(99), 990, 990.0 / 32);
+    EXPECT_LE(histogram.percentile(100), 1000);
+
+    histogram.reset();
+    EXPECT_EQ(histogram.count(), 0);
+    EXPECT_TRUE(std::isnan(histogram.percentile(50)));
+}
+
+TEST(HealthMetricAggregatorTest, TestHistogramRange)
+{
+    Histogram histogram(3);
+    // Zero, a fraction of a percent and bytes of memory
+    for (auto value : {0.0, 0.0, 0.25, 1.5e9})
+    {
+        histogram.record(value);
+    }
+    histogram.record(std::numeric_limits<double>::quiet_NaN());
+    EXPECT_EQ(histogram.count(), 4);
+    EXPECT_EQ(histogram.percentile(50), 0);
+    EXPECT_NEAR(histogram.percentile(75), 0.25, 0.25 / 8);
+    EXPECT_NEAR(histogram.percentile(100), 1.5e9, 1.5e9 / 8);
+}
+
+TEST(HealthMetricAggregatorTest, TestWindow)
+{
+    /** @brief Memory resource counting the allocations from the heap */
+    class CountingResource : public std::pmr::memory_resource
+    {
+      public:
+        size_t allocations = 0;
+        size_t bytes = 0;
+
+      private:
+        auto do_allocate(size_t size, size_t alignment) -> void* override
+        {
+            allocations++;
+            bytes += size;
+            return std::pmr::new_delete_resource()->allocate(size, alignment);
+        }
+        void do_deallocate(void* p, size_t size, size_t alignment) override
+        {
+            std::pmr::new_delete_resource()->deallocate(p, size, alignment);
+        }
+        auto do_is_equal(const std::pmr::memory_resource& other) const noexcept
+            -> bool override
+        {
+            return this == &other;
+        }
+    };
+
+    CountingResource memory;
+    const auto start = std::chrono::steady_clock::time_point{};
+    auto sample = [&](int i) {
+        return Sample{.timestamp = start + std::chrono::seconds(i),
+                      .value = static_cast<double>(i)};
+    };
+    auto values = [](const std::vector<Sample>& samples) {
+        std::vector<double> values;
+        for (const auto& s : samples)
+        {
+            values.push_back(s.value);
+        }
+        return values;
+    };
+
+    Window window(3, &memory);
+    EXPECT_EQ(window.push(sample(0)), std::nullopt);
+    EXPECT_EQ(window.push(sample(1)), std::nullopt);
+    EXPECT_EQ(window.push(sample(2)), std::nullopt);
+    EXPECT_EQ(window.size(), 3);
+    // The oldest sample is evicted once the window is full
+    for (auto i = 3; i < 10; i++)
+    {
+        auto evicted = window.push(sample(i));
+        ASSERT_TRUE(evicted);
+        EXPECT_EQ(evicted->value, i - 3);
+    }
+    EXPECT_EQ(window.size(), 3);
+    EXPECT_EQ(window[0].value, 7);
+    EXPECT_EQ(window.back().value, 9);
+    EXPECT_EQ(values(window.copy()), (std::vector<double>{7, 8, 9}));
+
+    // The window is allocated once, at its size, from the memory resource
+    EXPECT_EQ(memory.allocations, 1);
+    EXPECT_EQ(memory.bytes, 3 * sizeof(Sample));
+}
@@ -1,8 +1,20 @@
 #include "health_metric_collection.hpp"
 
+#include <sdbusplus/async.hpp>
 #include <sdbusplus/test/sdbus_mock.hpp>
 #include <xyz/openbmc_project/Metric/Value/server.hpp>
 
+#include <chrono>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C"
+{
+#include <unistd.h>
+}
+
 #include <gtest/gtest.h>
 
 namespace ConfigIntf = phosphor::health::metric::config;
@@ -31,6 +43,7 @@ class HealthMetricCollectionTest : public ::testing::Test
     const std::string thresholdInterface =
         sdbusplus::common::xyz::openbmc_project::common::Threshold::interface;
     ConfigIntf::HealthMetric::map_t configs;
+    phosphor::health::reader::BatchReader reader;
 
     void SetUp() override
     {
@@ -70,6 +83,19 @@ class HealthMetricCollectionTest : public ::testing::Test
         }
     }
 
+    /** @brief Run a single read of the collection on an event loop */
+    static void read(CollectionIntf::HealthMetricCollection& collection)
+    {
+        sdbusplus::async::context ctx;
+        ctx.spawn([](sdbusplus::async::context& ctx,
+                     CollectionIntf::HealthMetricCollection& collection)
+                      -> sdbusplus::async::task<> {
+            co_await collection.read(ctx);
+            ctx.request_stop();
+        }(ctx, collection));
+        ctx.run();
+    }
+
     void createCollection()
     {
         std::map<MetricIntf::Type,
@@ -80,8 +106,9 @@ class HealthMetricCollectionTest : public ::testing::Test
         {
             collections[type] =
                 std::make_unique<CollectionIntf::HealthMetricCollection>(
-                    bus, type, collectionConfig, bmcPaths);
-            collections[type]->read();
+                    bus, type, collectionConfig, bmcPaths, reader);
+            // Storage is read by the workers and awaited within the read
+            read(*collections[type]);
         }
     }
 };
@@ -156,12 +183,140 @@ TEST_F(HealthMetricCollectionTest, TestThresholdAsserted)
                 return 0;
             }));
 
-    // Test AssertionChanged signal generation
+    // Test AssertionChanged signal generation, of the default thresholds of
+    // CPU (2), memory (2), storage (2) and kernel (3)
     EXPECT_CALL(sdbusMock,
                 sd_bus_message_new_signal(IsNull(), NotNull(), NotNull(),
                                           StrEq(thresholdInterface),
                                           StrEq("AssertionChanged")))
-        .Times(6);
+        .Times(9);
 
     createCollection();
 }
+
+TEST_F(HealthMetricCollectionTest, TestProcessMainPid)
+{
+    ConfigIntf::HealthMetric config;
+    config.name = "Process_RSS";
+    config.subType = MetricIntf::SubType::processRSS;
+    config.windowSize = 1;
+    config.services = {"test.service"};
+    CollectionIntf::configs_t processConfigs = {config};
+    MetricIntf::paths_t bmcPaths = {};
+    CollectionIntf::HealthMetricCollection collection(
+        bus, MetricIntf::Type::process, processConfigs, bmcPaths, reader);
+    EXPECT_EQ(collection.services(), std::vector<std::string>{"test.service"});
+
+    auto values = 0;
+    EXPECT_CALL(sdbusMock,
+                sd_bus_emit_properties_changed_strv(
+                    IsNull(), NotNull(), StrEq(valueInterface), NotNull()))
+        .WillRepeatedly(Invoke(
+            [&]([[maybe_unused]] sd_bus* bus, [[maybe_unused]] const char* path,
+                [[maybe_unused]] const char* interface, const char** names) {
+                EXPECT_STREQ("Value", names[0]);
+                values++;
+                return 0;
+            }));
+
+    // Nothing is measured until the main PID of the service is known
+    reader.read();
+    read(collection);
+    EXPECT_EQ(values, 0);
+
+    // Measure this process as the main process of the service
+    collection.updatePid("test.service", getpid());
+    reader.read();
+    read(collection);
+    EXPECT_EQ(values, 1);
+
+    // The service stopped, its metric is stale until it runs again
+    collection.updatePid("test.service", 0);
+    EXPECT_EQ(values, 2);
+    reader.read();
+    read(collection);
+    EXPECT_EQ(values, 2);
+
+    collection.updatePid("test.service", getpid());
+    reader.read();
+    read(collection);
+    EXPECT_EQ(values, 3);
+
+    // The main process exited before its proc file could be opened
+    collection.updatePid("test.service", std::numeric_limits<uint32_t>::max());
+    EXPECT_EQ(values, 4);
+    reader.read();
+    read(collection);
+    EXPECT_EQ(values, 4);
+}
+
+TEST_F(HealthMetricCollectionTest, TestVMStatRates)
+{
+    CollectionIntf::configs_t vmstatConfigs;
+    for (auto subType : {MetricIntf::SubType::vmstatMajorFaults,
+                         MetricIntf::SubType::vmstatSwapIn,
+                         MetricIntf::SubType::vmstatSwapOut,
+                         MetricIntf::SubType::vmstatOomKills})
+    {
+        ConfigIntf::HealthMetric config;
+        config.name = MetricIntf::to_string(subType);
+        config.subType = subType;
+        config.windowSize = 1;
+        vmstatConfigs.emplace_back(std::move(config));
+    }
+    MetricIntf::paths_t bmcPaths = {};
+    CollectionIntf::HealthMetricCollection collection(
+        bus, MetricIntf::Type::vmstat, vmstatConfigs, bmcPaths, reader);
+
+    auto values = 0;
+    EXPECT_CALL(sdbusMock,
+                sd_bus_emit_properties_changed_strv(
+                    IsNull(), NotNull(), StrEq(valueInterface), NotNull()))
+        .WillRepeatedly(Invoke(
+            [&]([[maybe_unused]] sd_bus* bus, [[maybe_unused]] const char* path,
+                [[maybe_unused]] const char* interface, const char** names) {
+                EXPECT_STREQ("Value", names[0]);
+                values++;
+                return 0;
+            }));
+
+    // The rates need the counters of two cycles
+    reader.read();
+    read(collection);
+    EXPECT_EQ(values, 0);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    reader.read();
+    read(collection);
+    EXPECT_EQ(values, 4);
+}
+
+TEST_F(HealthMetricCollectionTest, TestStorageAwaited)
+{
+    CollectionIntf::configs_t storageConfigs;
+    ConfigIntf::HealthMetric config;
+    config.name = "Storage_TMP";
+    config.subType = MetricIntf::SubType::NA;
+    config.path = "/tmp";
+    config.windowSize = 1;
+    storageConfigs.emplace_back(std::move(config));
+    MetricIntf::paths_t bmcPaths = {};
+    CollectionIntf::HealthMetricCollection collection(
+        bus, MetricIntf::Type::storage, storageConfigs, bmcPaths, reader);
+
+    auto values = 0;
+    EXPECT_CALL(sdbusMock,
+                sd_bus_emit_properties_changed_strv(
+                    IsNull(), NotNull(), StrEq(valueInterface), NotNull()))
+        .WillRepeatedly(Invoke(
+            [&]([[maybe_unused]] sd_bus* bus, [[maybe_unused]] const char* path,
+                [[maybe_unused]] const char* interface, const char** names) {
+                EXPECT_STREQ("Value", names[0]);
+                values++;
+                return 0;
+            }));
+
+    // The statvfs on the workers is published by the read which submitted it
+    read(collection);
+    EXPECT_EQ(values, 1);
+}
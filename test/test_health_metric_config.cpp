@@ -2,6 +2,7 @@
 
 #include <sdbusplus/test/sdbus_mock.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <set>
 #include <utility>
@@ -39,10 +40,42 @@ bool isValidSubType(metric::Type type, metric::SubType subType)
                          metric::SubType::memoryBufferedAndCached,
                          metric::SubType::memoryFree,
                          metric::SubType::memoryShared,
-                         metric::SubType::memoryTotal}
+                         metric::SubType::memoryTotal,
+                         metric::SubType::memorySwapFree,
+                         metric::SubType::memorySwapTotal}
+                .contains(subType);
+
+        case metric::Type::cgroup:
+            return set_t{metric::SubType::cgroupCPU,
+                         metric::SubType::cgroupMemory}
+                .contains(subType);
+
+        case metric::Type::kernel:
+            return set_t{metric::SubType::kernelFileHandles,
+                         metric::SubType::kernelProcesses,
+                         metric::SubType::kernelLoad1,
+                         metric::SubType::kernelLoad5,
+                         metric::SubType::kernelLoad15,
+                         metric::SubType::kernelContextSwitches,
+                         metric::SubType::kernelForks}
+                .contains(subType);
+
+        case metric::Type::process:
+            return set_t{metric::SubType::processRSS,
+                         metric::SubType::processPSS}
+                .contains(subType);
+
+        case metric::Type::vmstat:
+            return set_t{metric::SubType::vmstatMajorFaults,
+                         metric::SubType::vmstatSwapIn,
+                         metric::SubType::vmstatSwapOut,
+                         metric::SubType::vmstatOomKills}
                 .contains(subType);
 
         case metric::Type::storage:
+            return set_t{metric::SubType::NA, metric::SubType::storageMounts}
+                .contains(subType);
+
         case metric::Type::inode:
             return set_t{metric::SubType::NA}.contains(subType);
 
@@ -70,7 +103,44 @@ TEST(HealthMonitorConfigTest, TestConfigValues)
                 count_with_thresholds++;
             }
         }
+    }
+    // Some metric types, like the kernel ones, have no default thresholds
+    EXPECT_GE(count_with_thresholds, 1);
+}
+
+TEST(HealthMonitorConfigTest, TestDefaultConfigValues)
+{
+    auto healthMetricConfigs = getHealthMetricConfigs();
 
-        EXPECT_GE(count_with_thresholds, 1);
+    auto& cpuConfigs = healthMetricConfigs[metric::Type::cpu];
+    auto cpu = std::ranges::find_if(
+        cpuConfigs, [](auto& config) { return config.name == "CPU"; });
+    ASSERT_NE(cpu, cpuConfigs.end());
+    EXPECT_EQ(cpu->subType, metric::SubType::cpuTotal);
+    auto critical = cpu->thresholds.find(
+        {metric::ThresholdIntf::Type::Critical,
+         metric::ThresholdIntf::Bound::Upper});
+    ASSERT_NE(critical, cpu->thresholds.end());
+    EXPECT_EQ(critical->second.value, 90.0);
+    EXPECT_TRUE(critical->second.log);
+    EXPECT_EQ(critical->second.windowSize, Threshold::defaults::windowSize);
+
+    auto& storageConfigs = healthMetricConfigs[metric::Type::storage];
+    auto storage = std::ranges::find_if(storageConfigs, [](auto& config) {
+        return config.name == "Storage_RW";
+    });
+    ASSERT_NE(storage, storageConfigs.end());
+    EXPECT_EQ(storage->path, "/run/initramfs/rw");
+
+    // Only the kernel metrics relative to their limits have default
+    // thresholds, platforms opt in to the ones of the loads and rates
+    for (auto type : {metric::Type::kernel, metric::Type::vmstat})
+    {
+        for (const auto& config : healthMetricConfigs[type])
+        {
+            auto relative = config.name == "Kernel_File_Handles" ||
+                            config.name == "Kernel_Processes";
+            EXPECT_EQ(config.thresholds.empty(), !relative) << config.name;
+        }
     }
 }
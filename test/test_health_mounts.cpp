@@ -0,0 +1,104 @@
+#include "health_mounts.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+extern "C"
+{
+#include <unistd.h>
+}
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace phosphor::health::mounts;
+
+static constexpr auto mountinfo =
+    "22 1 179:2 / / rw,relatime shared:1 - ext4 /dev/mmcblk0p2 rw\n"
+    "23 22 0:21 / /proc rw,nosuid,nodev,noexec,relatime shared:5 - proc proc "
+    "rw\n"
+    "24 22 0:22 / /sys rw,nosuid,nodev,noexec,relatime shared:6 - sysfs "
+    "sysfs rw\n"
+    "25 22 0:23 / /tmp rw,nosuid,nodev shared:7 - tmpfs tmpfs rw,size=1024k\n"
+    "26 22 7:0 / /usr/share ro,relatime - squashfs /dev/loop0 ro\n"
+    "27 22 8:1 / /run/media/usb\\040stick rw,relatime - vfat /dev/sda1 rw\n"
+    "28 22 0:24 / /var rw,relatime - overlay overlay rw,lowerdir=/a\n"
+    "29 22 8:2 / /mnt/broken rw,relatime - ext4 /dev/sda2 ro,errors=remount\n";
+
+TEST(HealthMountsTest, TestParse)
+{
+    auto mounts = parse(mountinfo);
+    ASSERT_EQ(mounts.size(), 8);
+
+    EXPECT_EQ(mounts[0].point, "/");
+    EXPECT_EQ(mounts[0].fsType, "ext4");
+    EXPECT_TRUE(mounts[0].writable);
+    EXPECT_EQ(mounts[1].fsType, "proc");
+    // Read-only mount, and read-write mount of a read-only filesystem
+    EXPECT_FALSE(mounts[4].writable);
+    EXPECT_FALSE(mounts[7].writable);
+    // Escaped space in the mount point
+    EXPECT_EQ(mounts[5].point, "/run/media/usb stick");
+    EXPECT_EQ(mounts[5].fsType, "vfat");
+
+    // Truncated and empty lines are skipped
+    EXPECT_THAT(parse("30 22 8:3 / /mnt rw - ext4\n\n"), testing::IsEmpty());
+}
+
+TEST(HealthMountsTest, TestFilter)
+{
+    auto points = [](const Filter& filter) {
+        std::vector<std::string> points;
+        for (const auto& mount : parse(mountinfo))
+        {
+            if (filter.matches(mount))
+            {
+                points.emplace_back(mount.point);
+            }
+        }
+        return points;
+    };
+
+    // Writable mounts with storage, but not the pseudo filesystems
+    EXPECT_THAT(points(Filter({}, {})),
+                testing::ElementsAre("/", "/tmp", "/run/media/usb stick",
+                                     "/var"));
+    // By mount point and by filesystem type
+    EXPECT_THAT(points(Filter({"/run/media/*", "overlay"}, {})),
+                testing::ElementsAre("/run/media/usb stick", "/var"));
+    EXPECT_THAT(points(Filter({}, {"tmpfs", "/run/*"})),
+                testing::ElementsAre("/", "/var"));
+    // Pseudo filesystems aren't monitored even if included
+    EXPECT_THAT(points(Filter({"/proc"}, {})), testing::IsEmpty());
+}
+
+TEST(HealthMountsTest, TestMountTable)
+{
+    auto path = std::filesystem::temp_directory_path() /
+                ("mountinfo_" + std::to_string(getpid()));
+    // Longer than a single read of the table
+    std::string content;
+    for (auto i = 0; i < 200; i++)
+    {
+        content += "40 22 8:1 / /mnt/" + std::to_string(i) +
+                   " rw,relatime - ext4 /dev/sda1 rw\n";
+    }
+    std::ofstream(path) << content;
+
+    MountTable table(path);
+    auto mounts = table.read();
+    ASSERT_EQ(mounts.size(), 200);
+    EXPECT_EQ(mounts.back().point, "/mnt/199");
+    // Only the kernel signals changes, not regular files
+    EXPECT_FALSE(table.changed());
+
+    std::filesystem::remove(path);
+    EXPECT_THAT(MountTable(path).read(), testing::IsEmpty());
+
+    // The mount table of the process has at least the root
+    MountTable self;
+    EXPECT_THAT(self.read(), testing::Contains(testing::Field(
+                                 &Mount::point, std::string("/"))));
+    EXPECT_FALSE(self.changed());
+}
@@ -0,0 +1,109 @@
+#include "health_shm.hpp"
+#include "health_shm_writer.hpp"
+
+#include <atomic>
+#include <cmath>
+#include <string>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+using namespace phosphor::health::shm;
+
+class SharedMemoryTest : public ::testing::Test
+{
+  public:
+    const std::string name =
+        "/test_health_shm_" + std::to_string(getpid());
+};
+
+TEST_F(SharedMemoryTest, TestReadCommitted)
+{
+    Writer writer(name);
+    auto cpu = *writer.add("CPU");
+    auto memory = *writer.add("Memory_Available");
+    writer.set(cpu, 12.5, 10, 0);
+    writer.set(memory, 1024, 2048, Flags::asserted);
+    writer.commit();
+
+    Reader reader(name);
+    EXPECT_EQ(reader.find("Memory_Available"), memory);
+    EXPECT_EQ(reader.find("Unknown"), std::nullopt);
+
+    auto entry = reader.read(cpu);
+    ASSERT_TRUE(entry);
+    EXPECT_STREQ(entry->name, "CPU");
+    EXPECT_EQ(entry->value, 12.5);
+    EXPECT_EQ(entry->window, 10);
+    EXPECT_NE(entry->timestamp, 0);
+
+    std::vector<Entry> entries;
+    EXPECT_NE(reader.snapshot(entries), 0);
+    ASSERT_EQ(entries.size(), 2);
+    EXPECT_EQ(entries[memory].flags, Flags::asserted);
+
+    // Values are only visible once committed
+    writer.set(cpu, 50, 20, Flags::stale);
+    EXPECT_EQ(reader.read(cpu)->value, 12.5);
+    writer.commit();
+    EXPECT_EQ(reader.read(cpu)->value, 50);
+    EXPECT_EQ(reader.read(cpu)->flags, Flags::stale);
+}
+
+TEST_F(SharedMemoryTest, TestLongNameSkipped)
+{
+    Writer writer(name);
+    const std::string prefix(nameSize - 1, 'a');
+    auto fits = writer.add(prefix);
+    EXPECT_EQ(writer.add(prefix + "_1"), std::nullopt);
+    EXPECT_EQ(writer.add(prefix + "_2"), std::nullopt);
+    writer.commit();
+
+    // The names which don't fit aren't truncated onto the one which does
+    Reader reader(name);
+    EXPECT_EQ(reader.find(prefix), fits);
+    std::vector<Entry> entries;
+    reader.snapshot(entries);
+    ASSERT_EQ(entries.size(), 1);
+    EXPECT_EQ(std::string_view(entries[0].name), prefix);
+}
+
+TEST_F(SharedMemoryTest, TestConsistentSnapshot)
+{
+    Writer writer(name);
+    for (auto i = 0; i < 16; i++)
+    {
+        writer.add("Metric_" + std::to_string(i));
+    }
+    writer.commit();
+    Reader reader(name);
+
+    std::atomic<bool> done = false;
+    std::thread thread([&]() {
+        for (auto value = 1; value <= 100000; value++)
+        {
+            for (size_t i = 0; i < 16; i++)
+            {
+                writer.set(i, value, value, 0);
+            }
+            writer.commit();
+        }
+        done = true;
+    });
+
+    std::vector<Entry> entries;
+    while (!done)
+    {
+        reader.snapshot(entries);
+        for (const auto& entry : entries)
+        {
+            if (!std::isnan(entries[0].value))
+            {
+                // All entries of a snapshot are from the same commit
+                ASSERT_EQ(entry.value, entries[0].value);
+                ASSERT_EQ(entry.window, entry.value);
+            }
+        }
+    }
+    thread.join();
+}
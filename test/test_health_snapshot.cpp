@@ -0,0 +1,107 @@
+#include "health_snapshot.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+extern "C"
+{
+#include <unistd.h>
+}
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+using namespace phosphor::health::snapshot;
+using namespace std::chrono_literals;
+using ::testing::HasSubstr;
+
+class HealthSnapshotTest : public ::testing::Test
+{
+  public:
+    std::filesystem::path directory =
+        std::filesystem::temp_directory_path() /
+        ("test_health_snapshot_" + std::to_string(getpid()));
+
+    void TearDown() override
+    {
+        std::filesystem::remove_all(directory);
+    }
+
+    /** @brief Poll the snapshotter until the snapshot files exist */
+    auto waitFiles(Snapshotter& snapshotter, size_t count) -> bool
+    {
+        for (auto i = 0; i < 500; i++)
+        {
+            snapshotter.poll();
+            if (files() >= count)
+            {
+                return true;
+            }
+            std::this_thread::sleep_for(10ms);
+        }
+        return false;
+    }
+
+    auto files() -> size_t
+    {
+        std::error_code ec;
+        auto entries = std::filesystem::directory_iterator(directory, ec);
+        return ec ? 0
+                  : std::distance(std::filesystem::begin(entries),
+                                  std::filesystem::end(entries));
+    }
+
+    auto content(size_t index) -> std::string
+    {
+        std::ifstream file(directory / ("snapshot." + std::to_string(index)));
+        return std::string(std::istreambuf_iterator<char>(file), {});
+    }
+
+    static auto trigger(const std::string& metric) -> Trigger
+    {
+        auto now = std::chrono::steady_clock::now();
+        return {.metric = metric,
+                .threshold = "Critical_Upper",
+                .value = 95,
+                .history = {{.timestamp = now - 1s, .value = 90},
+                            {.timestamp = now, .value = 95}}};
+    }
+};
+
+TEST_F(HealthSnapshotTest, TestCapture)
+{
+    Snapshotter snapshotter(directory, 1h, 4, 65536);
+    EXPECT_TRUE(snapshotter.capture(trigger("CPU")));
+    // Within the cooldown
+    EXPECT_FALSE(snapshotter.capture(trigger("Memory")));
+
+    ASSERT_TRUE(waitFiles(snapshotter, 1));
+    auto text = content(0);
+    EXPECT_THAT(text, HasSubstr("Metric: CPU\n"));
+    EXPECT_THAT(text, HasSubstr("Threshold: Critical_Upper\n"));
+    EXPECT_THAT(text, HasSubstr("-1.0s 90\n"));
+    EXPECT_THAT(text, HasSubstr("== Top processes by RSS =="));
+    EXPECT_THAT(text, HasSubstr("MemTotal:"));
+}
+
+TEST_F(HealthSnapshotTest, TestRotation)
+{
+    Snapshotter snapshotter(directory, 0s, 2, 256);
+    for (const auto* metric : {"First", "Second", "Third"})
+    {
+        EXPECT_TRUE(snapshotter.capture(trigger(metric)));
+    }
+    // The single worker writes the snapshots in order
+    std::this_thread::sleep_for(3s);
+    snapshotter.poll();
+
+    EXPECT_EQ(files(), 2);
+    EXPECT_THAT(content(0), HasSubstr("Metric: Third\n"));
+    EXPECT_THAT(content(1), HasSubstr("Metric: Second\n"));
+    EXPECT_LE(content(0).size(), 256);
+    EXPECT_THAT(content(0), HasSubstr("[truncated]"));
+}
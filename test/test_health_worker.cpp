@@ -0,0 +1,155 @@
+#include "health_worker.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+extern "C"
+{
+#include <poll.h>
+}
+
+#include <gtest/gtest.h>
+
+using namespace phosphor::health::worker;
+using namespace std::chrono_literals;
+
+/** @brief Poll the pool until the expected number of results are received */
+template <typename Pool>
+static auto pollResults(Pool& pool, size_t count) -> std::vector<int>
+{
+    std::vector<int> results;
+    for (auto i = 0; i < 500 && results.size() < count; i++)
+    {
+        pool.poll([&](int result) { results.push_back(result); });
+        std::this_thread::sleep_for(10ms);
+    }
+    return results;
+}
+
+TEST(HealthWorkerTest, TestSpscQueue)
+{
+    SpscQueue<int, 4> queue;
+    EXPECT_FALSE(queue.pop());
+    for (auto i = 0; i < 4; i++)
+    {
+        EXPECT_TRUE(queue.push(int{i}));
+    }
+    EXPECT_FALSE(queue.push(4));
+    for (auto i = 0; i < 4; i++)
+    {
+        EXPECT_EQ(queue.pop(), i);
+    }
+    EXPECT_FALSE(queue.pop());
+}
+
+TEST(HealthWorkerTest, TestSpscQueueThreaded)
+{
+    constexpr auto count = 10000;
+    SpscQueue<int, 64> queue;
+    std::thread producer([&] {
+        for (auto i = 0; i < count; i++)
+        {
+            while (!queue.push(int{i}))
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+    for (auto expected = 0; expected < count;)
+    {
+        if (auto value = queue.pop())
+        {
+            ASSERT_EQ(*value, expected);
+            expected++;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+}
+
+TEST(HealthWorkerTest, TestWorkerPool)
+{
+    WorkerPool<int> pool(2);
+    for (auto i = 0; i < 10; i++)
+    {
+        pool.submit([i] { return i; });
+    }
+    auto results = pollResults(pool, 10);
+    std::ranges::sort(results);
+    EXPECT_EQ(results, (std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+}
+
+TEST(HealthWorkerTest, TestWorkerPoolBlockedJob)
+{
+    std::promise<void> release;
+    auto blocked = release.get_future().share();
+    {
+        WorkerPool<int> pool(2);
+        // A job which doesn't return doesn't hold up the others
+        pool.submit([blocked] {
+            blocked.wait();
+            return -1;
+        });
+        pool.submit([] { return 1; });
+        EXPECT_EQ(pollResults(pool, 1), (std::vector<int>{1}));
+    }
+    // Nor the destruction of the pool
+    release.set_value();
+}
+
+TEST(HealthWorkerTest, TestWorkerPoolGrows)
+{
+    std::promise<void> release;
+    auto blocked = release.get_future().share();
+    {
+        WorkerPool<int> pool(1, 3);
+        EXPECT_EQ(pool.threads(), 1);
+        // Jobs blocked on all the workers don't hold up the next ones
+        for (auto i = 0; i < 2; i++)
+        {
+            pool.submit([blocked] {
+                blocked.wait();
+                return -1;
+            });
+        }
+        pool.submit([] { return 1; });
+        EXPECT_EQ(pollResults(pool, 1), (std::vector<int>{1}));
+        EXPECT_EQ(pool.threads(), 3);
+
+        // Up to the maximum
+        pool.submit([blocked] {
+            blocked.wait();
+            return -1;
+        });
+        pool.submit([] { return 2; });
+        EXPECT_EQ(pool.threads(), 3);
+        release.set_value();
+        auto results = pollResults(pool, 4);
+        std::ranges::sort(results);
+        EXPECT_EQ(results, (std::vector<int>{-1, -1, -1, 2}));
+    }
+}
+
+TEST(HealthWorkerTest, TestWorkerPoolEvent)
+{
+    WorkerPool<int> pool(1);
+    auto readable = [&pool](int timeout) {
+        pollfd fd{.fd = pool.fd(), .events = POLLIN, .revents = 0};
+        return ::poll(&fd, 1, timeout) == 1;
+    };
+    EXPECT_FALSE(readable(0));
+
+    pool.submit([] { return 1; });
+    EXPECT_TRUE(readable(5000));
+    std::vector<int> results;
+    pool.poll([&](int result) { results.push_back(result); });
+    EXPECT_EQ(results, std::vector<int>{1});
+    // Collecting the results resets the event
+    EXPECT_FALSE(readable(0));
+}